@@ -4,152 +4,384 @@
 #ifndef ARCHIVATOR_FLACALGO_HPP
 #define ARCHIVATOR_FLACALGO_HPP
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <fstream>
+#include <optional>
+#include <span>
 #include <vector>
 #include <filesystem>
-#include <dto/BitSteam.hpp>
-#include <dto/WAWHeader.hpp>
+#include <dto/BitWriter.hpp>
+#include <dto/BitReader.hpp>
 #include <dto/CommonInformation.hpp>
+#include <audio/LpcAnalysis.hpp>
+#include <audio/RiceCoder.hpp>
+#include <audio/WavReader.hpp>
 
 #include <controller/IController.hpp>
+#include <parallel/ThreadPool.hpp>
 
 /**
  *
  */
 static constexpr  int kGlobalSizeBlocks = 16384 * 8; // Size of blocks (INT32_MAX for 1 block)
-static constexpr int kGlobalOrder = 25;            // LPC model GLOBAL_ORDER
-static constexpr int kGlobalK = 8;                // Rice code parameter
+static constexpr uint32_t kStreamBlockFrames = 4096; // Default block size of streaming encode (about 93 ms at 44.1 kHz)
+static constexpr int kGlobalOrder = 25;            // Highest LPC order the encoder considers
+static constexpr int kRicePartitionSamples = 4096; // Residuals per Rice partition (each partition has its own k)
+static constexpr unsigned kRiceParameterBits = 5;  // Width of a stored partition k
+static constexpr unsigned kLpcPrecision = 15;      // Width of a quantized LPC coefficient (two's complement)
+static constexpr unsigned kLpcShiftBits = 4;       // Width of the stored quantization shift
+static constexpr unsigned kLpcOrderBits = 5;       // Width of the stored LPC order (0..kGlobalOrder)
+static constexpr unsigned kFixedMaxOrder = 4;      // Highest order of the fixed polynomial predictors
+static constexpr unsigned kFixedOrderBits = 3;     // Width of the stored fixed predictor order
+static constexpr LpcAnalysis::Window kLpcWindow = LpcAnalysis::Window::Tukey; // Analysis window of Lpc::train
+static_assert(kGlobalOrder < (1 << kLpcOrderBits) && kFixedMaxOrder < (1u << kFixedOrderBits));
 
 // Linear predictive coding
 /**
  * @brief Audio compression algorithm inspired by FLAC (lossless compression for WAV audio).
  *
- * Implements a simplified FLAC-like compression for 16-bit PCM mono WAV files using linear predictive coding (LPC) and Rice coding. The algorithm reads a WAV file, computes LPC coefficients for blocks of audio samples, encodes the coefficients and residuals using Rice codes, and writes a compressed file with ".flac" extension (not standard FLAC format, but a custom binary format).
+ * Implements a simplified FLAC-like compression for 16/24-bit PCM WAV files with any number of channels using linear predictive coding (LPC) and Rice coding. The algorithm reads a WAV file, computes LPC coefficients for blocks of audio samples, encodes the coefficients and residuals using Rice codes, and writes a compressed file with ".flac" extension (not standard FLAC format, but a custom binary format).
  */
 class FlacAlgo final : public IController {
+    /// Version of the .flac layout written by encode(); stored as the last byte of kFlacMagic.
+    static constexpr uint8_t kFlacFormatVersion = 8;
+    /// Leading bytes of a .flac file. Files of the original layout start with the WAV header ("RIFF") instead.
+    static constexpr std::array<uint8_t, 8> kFlacMagic = {0x89, 'A', 'F', 'L', '\r', '\n', 0x1A, kFlacFormatVersion};
+
+    /**
+     * @brief Inter-channel decorrelation of a stereo block (stored as the first byte of the block).
+     *
+     * The side channel is `left - right` and needs one bit more than the input; mid is `(left + right) >> 1`, and the bit lost
+     * by the shift is the low bit of side.
+     */
+    enum class Decorrelation : uint8_t {
+        Independent = 0, ///< Channels coded as they are (always used unless there are exactly two channels).
+        LeftSide = 1,    ///< Left, then side.
+        RightSide = 2,   ///< Side, then right.
+        MidSide = 3,     ///< Mid, then side.
+    };
+
+    /**
+     * @brief Entry of the seek table: where a block starts, in samples and in bytes.
+     *
+     * The table of a stream has one point per block plus a final one holding the frame count and the end of the block data,
+     * so block `b` covers frames `[seek[b].first_frame, seek[b + 1].first_frame)` and bytes `[seek[b].offset, seek[b + 1].offset)`.
+     */
+    struct SeekPoint {
+        uint64_t first_frame = 0; ///< Index of the first frame of the block.
+        uint64_t offset = 0;      ///< Byte offset of the block, relative to the first block.
+    };
+    static_assert(sizeof(SeekPoint) == 2 * sizeof(uint64_t));
+
+    /**
+     * @brief Parsed header of a .flac file; the spans point into the file's bytes.
+     */
+    struct FlacStream {
+        uint16_t channels = 0;
+        uint16_t bits_per_sample = 0;
+        uint64_t frames = 0;
+        std::span<const uint8_t> prefix;  ///< WAV bytes before the samples.
+        std::span<const uint8_t> trailer; ///< WAV bytes after the samples.
+        uint32_t block_frames = 0;        ///< Largest number of frames in a block.
+        std::vector<SeekPoint> seek;      ///< Seek table, `block count + 1` points.
+        std::span<const uint8_t> blocks;  ///< Coded blocks.
+
+        /// Bytes of block @p b.
+        std::span<const uint8_t> block(size_t b) const {
+            return blocks.subspan(seek[b].offset, seek[b + 1].offset - seek[b].offset);
+        }
+
+        /// Number of frames in block @p b.
+        size_t block_size(size_t b) const { return static_cast<size_t>(seek[b + 1].first_frame - seek[b].first_frame); }
+    };
+
     /**
      * @brief Internal class implementing Linear Predictive Coding (LPC).
      *
      * The LPC class is used to compute prediction coefficients from audio samples and to predict sample values. It uses the Levinson-Durbin algorithm to determine LPC coefficients for a given block of audio.
+     * The coefficients are then quantized to kLpcPrecision-bit integers with a common shift, and prediction runs in integer arithmetic only, so encoder and decoder agree bit for bit on every platform.
+     * Alternatively the model is one of the fixed polynomial predictors of FLAC (orders 0..kFixedMaxOrder), which need no analysis and no stored coefficients.
      */
     class Lpc {
-        std::vector<double> coeffs_; ///< LPC coefficients for the current model (size = kGlobalOrder+1).
+        std::vector<double> coeffs_; ///< Levinson-Durbin coefficients of the chosen order (size = order_+1, coeffs_[i] weights the sample i steps back).
+        std::array<int32_t, kGlobalOrder> reversed_{}; ///< Quantized coefficients, oldest tap first: reversed_[order_ - i] ≈ coeffs_[i] * 2^shift_.
+        unsigned shift_ = 0; ///< Quantization shift, 0..2^kLpcShiftBits-1.
+        unsigned order_ = 0; ///< Number of taps in use.
+        bool fixed_ = false; ///< reversed_ holds a fixed polynomial predictor instead of quantized LPC coefficients.
+        unsigned bits_ = 16;     ///< Sample width of the channel.
+        int32_t lo_ = INT16_MIN; ///< Smallest sample value of the channel.
+        int32_t hi_ = INT16_MAX; ///< Largest sample value of the channel.
     public:
         Lpc() = default;
+
         /**
-         * @brief Initialize LPC with given coefficients.
-         * @param coeffs Precomputed coefficient vector.
+         * @brief Set the sample range of the channel (signed @p bits-bit integers) that predictions are saturated to.
          */
-        explicit Lpc(std::vector<double> coeffs) : coeffs_(std::move(coeffs)) {}
+        void set_sample_bits(unsigned bits) {
+            bits_ = bits;
+            lo_ = -(int32_t{1} << (bits - 1));
+            hi_ = (int32_t{1} << (bits - 1)) - 1;
+        }
+
+        /**
+         * @brief Sample width set by set_sample_bits().
+         */
+        unsigned sample_bits() const { return bits_; }
 
         /**
          * @brief Train (compute) LPC coefficients on a block of audio samples.
-         * @param input Vector of audio samples (int16_t) to analyze.
+         * @param input Samples of one channel to analyze.
          *
-         * Uses the Levinson-Durbin recursion on the autocorrelation of the input signal to calculate `kGlobalOrder` LPC coefficients. The computed coefficients are stored internally and used for prediction.
+         * Windows the input with kLpcWindow, computes its autocorrelation up to lag kGlobalOrder and runs the Levinson-Durbin recursion on it (see LpcAnalysis).
+         * Each step m of the recursion yields the order-m predictor and its error energy, which estimate_bits() turns into a block cost;
+         * the coefficients of the cheapest order in 0..kGlobalOrder are stored.
          */
-        void train(const std::vector<int16_t> &input);
+        void train(const std::vector<int32_t> &input);
 
         /**
-         * @brief Predict the next sample using the LPC model.
+         * @brief Estimated size in bits of a block of @p n samples coded with an order-@p order predictor whose residual energy is @p error.
+         *
+         * Model header plus the Rice cost of Laplacian residuals, as in the reference FLAC encoder.
+         */
+        static double estimate_bits(double error, size_t n, unsigned order);
+
+        /**
+         * @brief Pick the fixed polynomial predictor with the smallest sum of absolute residuals over @p input.
+         *
+         * One pass over the block without autocorrelation, for fast encoding.
+         */
+        void choose_fixed(const std::vector<int32_t> &input);
+
+        /**
+         * @brief Load the fixed polynomial predictor of order @p order (0..kFixedMaxOrder).
+         */
+        void set_fixed(unsigned order);
+
+        /**
+         * @brief Quantize the trained coefficients.
+         *
+         * Picks the largest shift (at most 2^kLpcShiftBits-1) at which the biggest coefficient still fits into kLpcPrecision bits,
+         * then rounds the scaled coefficients, carrying each rounding error over to the next one as FLAC does.
+         */
+        void quantize();
+
+        /**
+         * @brief Write the model.
+         *
+         * One bit selects the kind. A fixed predictor stores its order in kFixedOrderBits bits; an LPC model stores its order in kLpcOrderBits bits
+         * followed, unless the order is 0, by the shift and order_ coefficients of kLpcPrecision bits.
+         */
+        void write(BitWriter &stream) const;
+
+        /**
+         * @brief Read a model written by write().
+         * @throws std::runtime_error if the stored order is out of range.
+         */
+        void read(BitReader &stream);
+
+        /**
+         * @brief Predict the next sample using the quantized LPC model.
          * @param input Vector of audio samples.
          * @param index The index of the sample to predict (function will predict sample at `index` based on previous samples).
-         * @return The predicted sample value (int16_t).
+         * @return The predicted sample value.
          *
-         * Calculates a predicted value using the formula: `prediction = coeffs_[0] + Σ_{i=1..order}(coeffs_[i] * input[index - i])`. If `index` is smaller than `i`, those terms are omitted.
+         * Calculates `(Σ_{i=1..order_} q_i * input[index - i]) >> shift_` in 64-bit integers, omitting the terms with `i > index`,
+         * and saturates the result to the sample range. From `index >= order_` on it is predict_full().
          */
-        int16_t predict(const std::vector<int16_t> &input, size_t index) const;
+        int32_t predict(const std::vector<int32_t> &input, size_t index) const;
+
+        /**
+         * @brief Predict a sample that has a full history.
+         * @param window The order_ samples preceding the predicted one, oldest first.
+         *
+         * The taps are a plain dot product over two contiguous arrays, which the compiler vectorizes.
+         */
+        int32_t predict_full(const int32_t *window) const {
+            int64_t sum = 0;
+            for (size_t i = 0; i < order_; ++i) {
+                sum += static_cast<int64_t>(reversed_[i]) * window[i];
+            }
+            return clamp_prediction(sum >> shift_);
+        }
+
+        /**
+         * @brief Convert a prediction to a sample value, saturating at the sample range (see set_sample_bits()).
+         */
+        int32_t clamp_prediction(int64_t prediction) const {
+            return static_cast<int32_t>(std::clamp<int64_t>(prediction, lo_, hi_));
+        }
 
         /**
          * @brief Reset the LPC model.
          *
-         * Clears the stored coefficients. Should be called after finishing with one block of data, before training on a new block.
+         * Clears the stored coefficients (trained and quantized). Should be called after finishing with one block of data, before training on a new block.
          */
         void clear();
         friend  class FlacAlgo;
     };
 
-    Lpc lpc_;  ///< LPC model instance used for encoding consecutive blocks.
-
     /**
-     * @brief Override: Send summary info with "FlacAlgo" tag.
-     * @param common_information Compression metrics (ratio, time, sizes).
+     * @brief Encode the samples of one channel of a block.
+     * @param samples Samples of the channel.
+     * @param bits Sample width of the channel (one more than the input for a side channel).
+     * @param fast Use a fixed polynomial predictor (Lpc::choose_fixed()) without LPC analysis.
+     * @return The subframe's own bit buffer (see the overload below), zero padded to a whole byte.
      *
-     * Outputs the summary of the FLAC compression results prefixed with "FlacAlgo{ ... }" to distinguish it from other algorithms.
+     * Trains a subframe-local Lpc model, so subframes can be coded on any thread in any order. Outside fast mode the channel is coded
+     * both with the trained model and with the best fixed predictor, and the shorter result is kept.
      */
-    void send_common_information(const CommonInformation &common_information) override;
+    static std::vector<uint8_t> encode_subframe(const std::vector<int32_t> &samples, unsigned bits, bool fast);
 
     /**
-     * @brief Override: Send error info with "FlacAlgo" tag.
-     * @param error Error message string.
-     *
-     * Formats and forwards error messages with a "FlacAlgo{ ... }" tag for clarity.
+     * @brief Encode the samples of one channel with a given model.
+     * @return The model (see Lpc::write()), then the residuals in Rice partitions (see encode_residuals()), zero padded to a whole byte.
      */
-    void send_error_information(const std::string &error) override;
+    static std::vector<uint8_t> encode_subframe(const std::vector<int32_t> &samples, const Lpc &lpc);
 
     /**
-     * @brief Log global compression parameters.
+     * @brief Decode one subframe written by encode_subframe().
+     * @param subframe Bytes of the subframe.
+     * @param count Number of samples in the subframe.
+     * @param bits Sample width of the channel.
+     * @return The reconstructed samples.
+     * @throws std::runtime_error if the subframe is shorter than its content.
      *
-     * Outputs a line listing the global constants used by the FLAC algorithm (such as block size, LPC order, Rice parameter). This helps in debugging or confirming the settings used for compression.
+     * Reads the LPC model, Rice-decodes all residuals in one pass (decode_residuals()), then runs the integer LPC synthesis
+     * filter over the subframe; samples past the warm-up use Lpc::predict_full().
      */
-    void send_global_params() const;
+    static std::vector<int32_t> decode_subframe(std::span<const uint8_t> subframe, size_t count, unsigned bits);
+
+    /**
+     * @brief Number of candidate signals coded per block: the channels, plus side and mid for stereo.
+     */
+    static unsigned candidate_count(unsigned channels) { return channels == 2 ? 4 : channels; }
+
+    /**
+     * @brief Extract candidate signal @p candidate (see candidate_count(); 2 = side, 3 = mid) of a block.
+     * @param pcm Interleaved little-endian PCM bytes of the block's frames.
+     */
+    static std::vector<int32_t> read_candidate(std::span<const uint8_t> pcm, unsigned channels, unsigned bits_per_sample, unsigned candidate);
+
+    /**
+     * @brief Code one block of interleaved PCM on the calling thread (read_candidate(), encode_subframe(), assemble_block()).
+     */
+    static std::vector<uint8_t> encode_block(std::span<const uint8_t> pcm, unsigned channels, unsigned bits_per_sample, bool fast);
 
     /**
-     * @brief Encode a single integer using Rice coding.
-     * @param stream BitStream to write bits into.
-     * @param num Integer number to encode (can be negative, uses sign bit).
+     * @brief Writes one .flac file block by block.
      *
-     * Rice coding encodes the number in two parts: a unary representation of `num >> kGlobalK` followed by a fixed `kGlobalK`-bit remainder. A leading sign bit is also added (1 for negative, 0 for non-negative).
+     * The constructor writes the header with the block count, frame count and index offset still zero; add() appends
+     * blocks as they are coded, and finish() appends the WAV trailer and the seek table, then seeks back to fill in the
+     * totals. So the length of the input need not be known before the first block is written.
      */
-    static void rice_encode(BitStream &stream, int num);
+    class BlockWriter {
+    public:
+        /**
+         * @brief Write the header.
+         * @param output Seekable stream positioned where the file starts (must outlive the writer).
+         * @param prefix WAV bytes before the samples.
+         */
+        BlockWriter(std::ostream &output, uint16_t channels, uint16_t bits_per_sample, uint32_t block_frames, std::span<const uint8_t> prefix);
+
+        /**
+         * @brief Append a block of @p frames frames and its seek point.
+         */
+        void add(std::span<const uint8_t> block, size_t frames);
+
+        /**
+         * @brief Append the WAV trailer and the seek table and complete the header.
+         */
+        void finish(std::span<const uint8_t> trailer);
+
+        /**
+         * @brief Frames written so far.
+         */
+        uint64_t frames() const { return seek_.back().first_frame; }
+
+    private:
+        std::ostream &output_;
+        std::streampos totals_pos_;                           ///< Position of the block count in the header.
+        std::vector<SeekPoint> seek_ = std::vector<SeekPoint>(1); ///< Seek points of the blocks written so far, plus the end.
+    };
 
     /**
-     * @brief Decode a single integer from Rice coding.
-     * @param stream BitStream to read bits from.
-     * @return The decoded integer.
+     * @brief Join the coded candidates of one block.
+     * @param channels Number of channels of the input.
+     * @param candidates Subframes of all candidate signals, in the order of read_candidate().
+     * @return The block: a Decorrelation byte, then for each channel a uint32 subframe size and the subframe.
      *
-     * This performs the inverse of `rice_encode`, reading a sign bit, then reading a unary count of bits until a zero, and then `kGlobalK` bits for the remainder, to reconstruct the original integer.
+     * For stereo the pair of subframes with the smallest total size decides the Decorrelation.
      */
-    static int rice_decode(BitStream &stream);
+    static std::vector<uint8_t> assemble_block(unsigned channels, const std::vector<std::vector<uint8_t>> &candidates);
 
     /**
-     * @brief Encode a sequence of 16-bit values using Rice coding.
-     * @param vec Vector of int16_t values to encode.
-     * @return A vector of bytes containing the Rice-coded bits.
+     * @brief Decode one block written by assemble_block().
+     * @param block Bytes of the block.
+     * @param frames Number of frames in the block.
+     * @param channels Number of channels.
+     * @param bits_per_sample Sample width (16 or 24).
+     * @return The frames as interleaved little-endian PCM bytes.
+     * @throws std::runtime_error if the block is malformed.
+     */
+    static std::vector<uint8_t> decode_block(std::span<const uint8_t> block, size_t frames, unsigned channels, unsigned bits_per_sample);
+
+    /**
+     * @brief Same as decode_block(), but return the samples of each channel instead of PCM bytes.
+     * @return One vector of @p frames samples per channel, stereo decorrelation already undone.
+     * @throws std::runtime_error if the block is malformed.
+     */
+    static std::vector<std::vector<int32_t>> decode_block_channels(std::span<const uint8_t> block, size_t frames, unsigned channels, unsigned bits_per_sample);
+
+    /**
+     * @brief Check `kFlacMagic` and the format version of a .flac file.
+     * @return false (after logging an error) if the file has another layout or version.
+     */
+    bool check_format(std::span<const uint8_t> data, const std::string &input_filename);
+
+    /**
+     * @brief Parse the header and seek table of a .flac file that passed check_format().
+     * @throws std::runtime_error if the header or the seek table is inconsistent.
+     */
+    static FlacStream read_stream(std::span<const uint8_t> data);
+
+    /**
+     * @brief Rice-decode `out.size()` consecutive residuals written by encode_residuals() with the same @p escape_bits (see RiceCoder::decode_block()).
+     */
+    static void decode_residuals(BitReader &stream, std::span<int32_t> out, unsigned escape_bits);
+
+    /**
+     * @brief Override: Send summary info with "FlacAlgo" tag.
+     * @param common_information Compression metrics (ratio, time, sizes).
      *
-     * Iterates through the input vector and encodes each value using `rice_encode` into a BitStream, then returns the underlying byte buffer from that stream.
+     * Outputs the summary of the FLAC compression results prefixed with "FlacAlgo{ ... }" to distinguish it from other algorithms.
      */
-    static std::vector<uint8_t> encode_vector(const std::vector<int16_t> &vec);
+    void send_common_information(const CommonInformation &common_information) override;
 
     /**
-     * @brief Decode a sequence of bytes into 16-bit values using Rice coding.
-     * @param data Vector of bytes containing Rice-coded data (as produced by encode_vector).
-     * @return A vector of int16_t values decoded from the input data.
+     * @brief Override: Send error info with "FlacAlgo" tag.
+     * @param error Error message string.
      *
-     * Reads bits from the provided data using a BitStream and repeatedly applies `rice_decode` to obtain all original values until no more complete values can be read.
+     * Formats and forwards error messages with a "FlacAlgo{ ... }" tag for clarity.
      */
-    static std::vector<int16_t> decode_vector(std::vector<uint8_t> data);
+    void send_error_information(const std::string &error) override;
 
     /**
-     * @brief Read the WAV file header.
-     * @param filename Path to the WAV file.
-     * @param header Reference to a WavHeader struct to populate.
-     * @return `true` if a valid WAV header was read, `false` if the file format is invalid or file couldn't be opened.
+     * @brief Log global compression parameters.
      *
-     * Opens the file and reads the header bytes into `header`. It validates basic WAV format conditions (RIFF/WAVE markers, PCM format, mono channel). If the data chunk ID is not immediately after the fmt chunk, it seeks to find it.
+     * Outputs a line listing the global constants used by the FLAC algorithm (such as block size, LPC order, coefficient precision and shift, Rice partition size). This helps in debugging or confirming the settings used for compression.
      */
-    bool read_wav_header(const std::string &filename, WavHeader &header);
+    void send_global_params() const;
 
     /**
-     * @brief Read PCM audio data from a WAV file.
-     * @param filename Path to the WAV file.
-     * @param header WavHeader previously read from the file (used to know data size).
-     * @param start_index Starting sample index (0-based) from which to read data.
-     * @return A vector of int16_t audio samples read from the file, or empty if an error occurred.
+     * @brief Rice-encode residuals in partitions of kRicePartitionSamples, each prefixed with its own k (kRiceParameterBits bits).
+     * @param escape_bits The channel's sample width: a residual between two in-range values is smaller than 2^bits in magnitude,
+     *                    so its folded value fits into `escape_bits + 1` bits.
      *
-     * Seeks to the data section of the WAV file (skipping the header) and then further offsets by `start_index` samples. Reads either a full block of `kGlobalSizeBlocks` samples or the remaining samples if fewer are left. This is used to process large audio in chunks.
+     * The residuals are zigzag-folded once for the whole subframe and every partition is coded with RiceCoder::encode_block().
      */
-    std::vector<int16_t> read_wav_data(const std::string &filename, const WavHeader &header, size_t start_index);
+    static void encode_residuals(BitWriter &stream, std::span<const int32_t> residuals, unsigned escape_bits);
 
 public:
     /**
@@ -164,29 +396,119 @@ public:
     /**
      * @brief Compress a WAV audio file.
      * @param input_filename Path to the input .wav file.
+     * @param threads Number of worker threads (0 = one per hardware thread).
+     * @param fast Use the fixed polynomial predictors instead of LPC analysis: faster, slightly larger output.
      *
-     * Reads the WAV header and validates it. Then processes the audio data in blocks of `kGlobalSizeBlocks` samples:
-     * For each block, it trains the LPC model to get prediction coefficients, then Rice-encodes these coefficients and the residuals (difference between actual samples and predicted samples).
-     * All encoded data (including a copy of the WAV header and the size of encoded data) is written to a file in "storageEncoded/" with extension ".flac".
+     * Opens the file once with a WavReader, which parses and validates the WAV header. Then processes the audio data in blocks of `kGlobalSizeBlocks` frames:
+     * every channel of a block (and for stereo also its side and mid signal) is a separate ThreadPool task that trains an LPC model of the cheapest order and quantizes it
+     * (or, in fast mode, picks a fixed predictor), then writes the model and the Rice-coded residuals (difference between actual samples and predicted samples) into the subframe's own buffer (see encode_subframe()).
+     * The subframes are then joined into blocks, choosing the cheapest stereo decorrelation (see assemble_block()).
+     * While a wave of blocks is being coded, the WavReader reads the next wave ahead on its background thread.
+     * The output file in "storageEncoded/" with extension ".flac" holds `kFlacMagic`, the channel count (uint16), the sample width (uint16), the block size in frames (uint32),
+     * the number of blocks (uint32), the frame count (uint64), the offset of the index (uint64, relative to the first block), the bytes of the WAV file before the samples (uint32 size and the bytes),
+     * the blocks in order, and at the index the bytes of the WAV file after the samples (uint32 size and the bytes, so the WAV file is restored byte for byte)
+     * and the seek table (`block count + 1` SeekPoint entries: the first frame and the byte offset of every block, then the totals),
+     * so every block can be located and decoded on its own (see decode_range()). The totals are filled in at the end (see BlockWriter).
+     * The output does not depend on the number of threads.
      * Finally, it logs the compression ratio, time, and global parameters used via `send_common_information` and `send_global_params()`.
      *
      * @throws If the WAV file cannot be read or if writing the output fails, an error is logged and the function may terminate the program.
      */
-    void encode(const std::string &input_filename);
+    void encode(const std::string &input_filename, unsigned threads = 0, bool fast = false);
+
+    /**
+     * @brief Incremental encoder for a WAV stream of unknown length (pipe, socket, live capture).
+     *
+     * Bytes are pushed as they arrive. Once the WAV header is complete the .flac header is written, and from then on
+     * every block is coded and written as soon as its last frame arrives, so output lags input by at most one block.
+     * finish() codes the last partial block and completes the file (see BlockWriter). A "data" chunk size of 0 or
+     * 0xFFFFFFFF, as written by capture tools that cannot seek, means "until the end of the stream".
+     *
+     * Everything runs on the calling thread and only one block of samples is buffered, so a single thread (for example
+     * an event loop over many descriptors) can keep many streams going. Blocks are coded exactly like encode() codes them
+     * (with the fast flag, the same predictor search).
+     */
+    class StreamEncoder {
+    public:
+        /**
+         * @brief Start a stream.
+         * @param output Seekable destination of the .flac file (must outlive the encoder).
+         * @param block_frames Frames per block: smaller means lower latency, larger means better compression.
+         * @param fast Use the fixed polynomial predictors instead of LPC analysis.
+         * @throws std::invalid_argument if @p block_frames is zero.
+         */
+        explicit StreamEncoder(std::ostream &output, uint32_t block_frames = kStreamBlockFrames, bool fast = false);
+
+        /**
+         * @brief Feed the next bytes of the WAV stream; complete blocks are written (and flushed) before returning.
+         * @throws std::runtime_error if the stream is not a supported WAV file.
+         */
+        void push(std::span<const uint8_t> bytes);
+
+        /**
+         * @brief End of the stream: write the last block, the trailer and the seek table.
+         * @throws std::runtime_error if the WAV header never completed.
+         */
+        void finish();
+
+        /**
+         * @brief Frames coded so far.
+         */
+        uint64_t frames() const { return writer_ ? writer_->frames() : 0; }
+
+    private:
+        /// Append sample bytes to the current block, coding each block as it fills; bytes past the data chunk go to the trailer.
+        void push_samples(std::span<const uint8_t> bytes);
+
+        std::ostream &output_;
+        uint32_t block_frames_;
+        bool fast_;
+        WavReader::Format format_;
+        std::string error_;                ///< Why the header is not complete yet.
+        std::vector<uint8_t> pending_;     ///< The header until it is complete, then the samples of the unfinished block.
+        std::optional<BlockWriter> writer_; ///< Engaged once the header is complete.
+        uint64_t samples_left_ = 0;        ///< Sample bytes still expected in the "data" chunk.
+        std::vector<uint8_t> trailer_;     ///< Bytes after the "data" chunk.
+    };
+
+    /**
+     * @brief Compress a WAV stream read from a pipe, FIFO or other file descriptor as it arrives.
+     * @param input_filename Path to read ("-" for standard input; also e.g. a FIFO or /dev/fd/N).
+     * @param block_frames Frames per block (see StreamEncoder).
+     * @param fast Use the fixed polynomial predictors instead of LPC analysis.
+     *
+     * Reads whatever is available and hands it to a StreamEncoder, so each block is written to "storageEncoded/" (named
+     * after the input, "stdin.flac" for standard input) as soon as it is complete. At the end of the input the header and
+     * the seek table are completed. Logs the compression ratio and time like encode().
+     *
+     * @throws If the input cannot be read or is not a supported WAV stream, an error is logged and the function terminates the program.
+     */
+    void encode_stream(const std::string &input_filename, uint32_t block_frames = kStreamBlockFrames, bool fast = false);
 
     /**
      * @brief Decompress a FLAC-compressed file.
      * @param input_filename Path to the .flac file to decode.
+     * @param threads Number of worker threads (0 = one per hardware thread).
      *
-     * **Current Implementation Note:** The decode function currently mirrors the encode logic (it was intended to perform decompression but as implemented it may simply recompute the same encoded stream). In a complete implementation, this would:
-     *  - Read the WAV header and encoded data size.
-     *  - For each encoded block, decode LPC coefficients and residuals using `rice_decode`, reconstruct audio samples using the LPC model, and accumulate them.
-     *  - Write the reconstructed audio samples to a WAV file in "storageDecoded/" with the original .wav extension.
-     *  - Log the time taken and compression ratio (which should match the original).
+     * Checks `kFlacMagic` and the format version, reads the stream header and the seek table, decodes the blocks on a ThreadPool (see decode_block())
+     * and writes the stored WAV prefix, the samples in order and the stored trailer to "storageDecoded/" with the extension replaced by ".wav".
+     * Files of another layout or version are rejected with an error message and terminate the program.
+     * Logs the time taken and size information via `send_common_information`.
+     */
+    void decode(const std::string &input_filename, unsigned threads = 0);
+
+    /**
+     * @brief Decode a range of samples of a FLAC-compressed file without decoding the rest.
+     * @param input_filename Path to the .flac file.
+     * @param first_sample Index of the first frame to return.
+     * @param count Number of frames; clamped at the end of the stream.
+     * @return `count * channels` samples, interleaved by frame.
      *
-     * @note This function should handle the reverse of encode, but it is not fully implemented in the current version.
+     * Finds the block holding @p first_sample by binary search in the seek table and decodes only the blocks that overlap
+     * the range, so the cost does not depend on where in the file the range lies.
+     * @throws std::runtime_error if the file cannot be read, is not a supported .flac file or @p first_sample is past the end.
      */
-    void decode(const std::string &input_filename);
+    std::vector<int32_t> decode_range(const std::string &input_filename, uint64_t first_sample, uint64_t count);
 };
 
 #endif
@@ -0,0 +1,83 @@
+#ifndef ARCHIVATOR_LPC_ANALYSIS_HPP
+#define ARCHIVATOR_LPC_ANALYSIS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/**
+ * @brief LPC analysis kernels: windowing, autocorrelation and the Levinson-Durbin recursion.
+ *
+ * The block is converted to float once and windowed. All lags up to the highest order of interest are then computed in one
+ * pass, and the recursion yields the predictor of every order on the way, so an order search costs no extra passes over the samples.
+ *
+ * Every autocorrelation kernel adds the exact float*float products in double precision in the same order (per lag, by
+ * ascending sample index), so all kernels return identical values and the encoder output does not depend on the CPU.
+ * The implementation is picked once at run time from the CPU features (see best_kernel()).
+ */
+class LpcAnalysis {
+public:
+    /**
+     * @brief Analysis windows.
+     */
+    enum class Window {
+        Rectangle, ///< No tapering.
+        Welch,     ///< Parabola `1 - ((i - c) / c)^2` with `c = (n - 1) / 2`.
+        Tukey      ///< Flat top with raised-cosine tapers over a fraction of the block (the reference FLAC encoder's default).
+    };
+
+    /**
+     * @brief Available autocorrelation kernels.
+     */
+    enum class Kernel {
+        Scalar,  ///< One pass over the samples per lag (reference).
+        Generic, ///< Eight lags per pass with independent accumulators; portable.
+        Avx2     ///< Sixteen lags per pass, four doubles per register with FMA.
+    };
+
+    /// Fraction of the block covered by the two cosine tapers of Window::Tukey.
+    static constexpr float kTukeyRatio = 0.5f;
+
+    /**
+     * @brief Convert samples to float and apply a window.
+     * @param samples Input samples.
+     * @param window Window shape.
+     * @return The windowed samples.
+     */
+    static std::vector<float> apply_window(std::span<const int32_t> samples, Window window);
+
+    /**
+     * @brief Autocorrelation of @p x for lags 0..@p max_lag.
+     * @param x Windowed samples.
+     * @param max_lag Highest lag.
+     * @param r Receives `max_lag + 1` values; lags not shorter than the input are zero.
+     */
+    static void autocorrelation(std::span<const float> x, unsigned max_lag, double *r);
+
+    /**
+     * @brief Same as autocorrelation(), with an explicitly chosen kernel (for tests and benchmarks).
+     *
+     * A kernel the CPU does not support falls back to Kernel::Generic.
+     */
+    static void autocorrelation(Kernel kernel, std::span<const float> x, unsigned max_lag, double *r);
+
+    /**
+     * @brief Fastest kernel supported by the running CPU.
+     */
+    static Kernel best_kernel();
+
+    /**
+     * @brief Levinson-Durbin recursion for all orders up to @p max_order.
+     * @param r Autocorrelation, lags 0..max_order.
+     * @param max_order Highest order.
+     * @param coeffs `max_order * max_order` values; row `m - 1` receives the order-m predictor `a_1..a_m`
+     *               (the prediction of `x[n]` is `Σ a_i * x[n - i]`).
+     * @param error `max_order + 1` values; `error[m]` receives the prediction error energy of order m.
+     * @return Highest order computed. The recursion stops early once the error reaches zero (silent or perfectly
+     *         predictable input); the rows and errors of higher orders are then left untouched.
+     */
+    static unsigned levinson_durbin(const double *r, unsigned max_order, double *coeffs, double *error);
+};
+
+#endif // ARCHIVATOR_LPC_ANALYSIS_HPP
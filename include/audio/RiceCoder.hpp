@@ -0,0 +1,69 @@
+#ifndef ARCHIVATOR_RICE_CODER_HPP
+#define ARCHIVATOR_RICE_CODER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include <dto/BitWriter.hpp>
+#include <dto/BitReader.hpp>
+
+/**
+ * @brief Block Rice coder for prediction residuals.
+ *
+ * Residuals are zigzag-folded to unsigned values once per block (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...), so a code
+ * needs no separate sign bit. A value `u` with parameter `k` is coded as `u >> k` zero bits, a one, and the `k` low bits
+ * of `u`: the whole code is a single BitWriter::put_bits() call, and the decoder finds the quotient with one
+ * `std::countl_zero` on a 64-bit window and usually takes the remainder from the same window.
+ *
+ * A quotient of kEscapeRun or more is replaced by an escape: kEscapeRun zeros without the terminating one, then the
+ * folded value verbatim, which bounds every code to `kEscapeRun + escape_bits` bits.
+ */
+class RiceCoder {
+public:
+    /// Zero run that marks an escaped value.
+    static constexpr unsigned kEscapeRun = 20;
+    /// Largest Rice parameter.
+    static constexpr unsigned kMaxParameter = 30;
+
+    /**
+     * @brief Map a signed value to an unsigned one: `v >= 0` -> `2v`, `v < 0` -> `-2v - 1`.
+     */
+    static uint32_t fold(int32_t v) { return static_cast<uint32_t>(v) << 1 ^ static_cast<uint32_t>(v >> 31); }
+
+    /**
+     * @brief Inverse of fold().
+     */
+    static int32_t unfold(uint32_t u) { return static_cast<int32_t>(u >> 1 ^ (0u - (u & 1))); }
+
+    /**
+     * @brief fold() a whole block.
+     */
+    static std::vector<uint32_t> fold(std::span<const int32_t> values);
+
+    /**
+     * @brief Exact number of bits encode_block() spends on @p folded with parameter @p k.
+     */
+    static uint64_t cost(std::span<const uint32_t> folded, unsigned k, unsigned escape_bits);
+
+    /**
+     * @brief Cheapest parameter (0..kMaxParameter) for @p folded.
+     *
+     * Starts from the bit width of the mean value and compares the exact cost of its neighbours.
+     */
+    static unsigned best_parameter(std::span<const uint32_t> folded, unsigned escape_bits);
+
+    /**
+     * @brief Append the codes of @p folded.
+     * @param k Rice parameter, 0..kMaxParameter.
+     * @param escape_bits Width of an escaped value; every value must fit into it.
+     */
+    static void encode_block(BitWriter &stream, std::span<const uint32_t> folded, unsigned k, unsigned escape_bits);
+
+    /**
+     * @brief Decode `out.size()` values written by encode_block() with the same @p k and @p escape_bits, unfolded.
+     */
+    static void decode_block(BitReader &stream, std::span<int32_t> out, unsigned k, unsigned escape_bits);
+};
+
+#endif // ARCHIVATOR_RICE_CODER_HPP
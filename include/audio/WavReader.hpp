@@ -0,0 +1,167 @@
+#ifndef ARCHIVATOR_WAV_READER_HPP
+#define ARCHIVATOR_WAV_READER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <dto/InputView.hpp>
+
+/**
+ * @brief PCM WAV file opened once, with its RIFF chunks parsed and background read-ahead.
+ *
+ * The file is mapped with an InputView and its header is parsed with parse_header().
+ *
+ * Samples are read straight from the mapping, so any number of threads can call sample() at once. prefetch() hands a
+ * range of frames to a background thread that faults its pages in, so on slow (e.g. network) storage the next blocks
+ * are already in memory by the time the coder reaches them.
+ */
+class WavReader {
+public:
+    /**
+     * @brief Sample format and data chunk position found by parse_header().
+     */
+    struct Format {
+        uint16_t channels = 0;
+        uint16_t bits_per_sample = 0;
+        uint16_t block_align = 0; ///< Bytes per frame.
+        size_t data_offset = 0;   ///< Offset of the first sample (end of the "data" chunk header).
+        uint32_t data_bytes = 0;  ///< Size field of the "data" chunk, as stored.
+    };
+
+    /**
+     * @brief Outcome of parse_header().
+     */
+    enum class HeaderStatus {
+        Complete,   ///< The "data" chunk header was reached.
+        Incomplete, ///< The bytes end before the "data" chunk header.
+        Invalid     ///< Not a supported WAV file.
+    };
+
+    /**
+     * @brief Walk the RIFF chunks at the start of a WAV file up to the "data" chunk header.
+     * @param head The first bytes of the file (the whole file, or what has arrived so far of a stream).
+     * @param format Receives the format when the result is HeaderStatus::Complete.
+     * @param error Receives the reason unless the result is HeaderStatus::Complete.
+     *
+     * Honours the pad byte after odd-sized chunks and takes the format from the "fmt " chunk on the way. PCM (also as
+     * WAVE_FORMAT_EXTENSIBLE) with 16 or 24 bits per sample and any number of channels is accepted.
+     */
+    static HeaderStatus parse_header(std::span<const uint8_t> head, Format &format, std::string &error);
+
+    /**
+     * @brief Decode the little-endian sample at @p p.
+     * @param bits_per_sample 16 or 24.
+     */
+    static int32_t decode_sample(const uint8_t *p, unsigned bits_per_sample) {
+        if (bits_per_sample == 16) {
+            return static_cast<int16_t>(p[0] | p[1] << 8);
+        }
+        // 24 bit: move the sample into the top of a 32-bit word and shift back to sign-extend
+        return static_cast<int32_t>(uint32_t{p[0]} << 8 | uint32_t{p[1]} << 16 | uint32_t{p[2]} << 24) >> 8;
+    }
+
+    /**
+     * @brief Open and parse a WAV file.
+     * @param filename Path to the file.
+     *
+     * Check is_open() afterwards; error() then tells what was wrong.
+     */
+    explicit WavReader(const std::string &filename);
+
+    /**
+     * @brief Stop the read-ahead thread.
+     */
+    ~WavReader();
+
+    WavReader(const WavReader &) = delete;
+    WavReader &operator=(const WavReader &) = delete;
+
+    /**
+     * @brief Whether the file was opened and is a supported WAV file.
+     */
+    bool is_open() const noexcept { return open_; }
+
+    /**
+     * @brief Why the file could not be used (empty when is_open()).
+     */
+    const std::string &error() const noexcept { return error_; }
+
+    /**
+     * @brief Number of interleaved channels.
+     */
+    uint16_t channels() const noexcept { return channels_; }
+
+    /**
+     * @brief Sample width in bits (16 or 24).
+     */
+    uint16_t bits_per_sample() const noexcept { return bits_per_sample_; }
+
+    /**
+     * @brief Number of complete frames (one sample of every channel) in the data chunk.
+     */
+    uint64_t frames() const noexcept { return frames_; }
+
+    /**
+     * @brief Everything before the samples: RIFF header, all chunks up to "data" and its chunk header.
+     */
+    std::span<const uint8_t> prefix() const noexcept { return prefix_; }
+
+    /**
+     * @brief Everything after the complete frames (partial frame, pad byte, trailing chunks).
+     */
+    std::span<const uint8_t> trailer() const noexcept { return trailer_; }
+
+    /**
+     * @brief Read one sample.
+     * @param frame Frame index, below frames().
+     * @param channel Channel index, below channels().
+     */
+    int32_t sample(size_t frame, unsigned channel) const {
+        return decode_sample(pcm_.data() + frame * block_align_ + channel * (bits_per_sample_ / 8u), bits_per_sample_);
+    }
+
+    /**
+     * @brief Interleaved PCM bytes of frames [first_frame, first_frame + count).
+     */
+    std::span<const uint8_t> pcm(size_t first_frame, size_t count) const {
+        return pcm_.subspan(first_frame * block_align_, count * block_align_);
+    }
+
+    /**
+     * @brief Queue frames [first_frame, first_frame + count) for read-ahead on the background thread.
+     *
+     * Returns immediately; the thread is started on the first call. Does nothing for a file that was read into memory.
+     */
+    void prefetch(size_t first_frame, size_t count);
+
+private:
+    /// Parse the header of the mapped file and locate the samples; false (with error_ set) if it is not a supported WAV file.
+    bool parse();
+
+    /// Body of the read-ahead thread: touch one byte per page of each queued range.
+    void prefetch_loop();
+
+    InputView input_;
+    bool open_ = false;
+    std::string error_;
+    uint16_t channels_ = 0;
+    uint16_t bits_per_sample_ = 0;
+    uint16_t block_align_ = 0;
+    uint64_t frames_ = 0;
+    std::span<const uint8_t> prefix_;
+    std::span<const uint8_t> pcm_;
+    std::span<const uint8_t> trailer_;
+
+    std::thread prefetcher_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::span<const uint8_t>> pending_; ///< Ranges still to be touched.
+    bool stop_ = false;
+};
+
+#endif // ARCHIVATOR_WAV_READER_HPP
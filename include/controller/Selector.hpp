@@ -23,7 +23,9 @@ public:
      * This examines the first file in the Dto and uses its extension along with the action (encode or decode) to choose an algorithm.
      * For example, if encoding a ".mp4" file, returns QUANTIZATION; if encoding an image file (".bmp", ".jpg", etc.), returns FRACTAL;
      * if encoding a ".wav", returns FLAC; otherwise defaults to HUFFMAN for other file types.
-     * For decoding, it checks the file extension of the compressed file (e.g., ".hcf" for Huffman, ".flac" for Flac).
+     * Encoding with "rans" as the first option selects RANS for any file type, and encoding with a "stream" option selects FLAC,
+     * so that "-" or /dev/stdin can be streamed even though they carry no ".wav" extension.
+     * For decoding, it checks the file extension of the compressed file (e.g., ".hcf" for Huffman, ".flac" for Flac, ".fic" for Fractal).
      */
     static AlgorithmEnum get_algorithm_from_dto(const Dto &dto);
 
@@ -41,7 +43,9 @@ public:
      * If `action` is false (decoding), it expects `name` to be a compressed file or directory:
      * - QUANTIZATION if extension is empty (assumes a directory name for video)
      * - FLAC for ".flac" files
+     * - FRACTAL for ".fic" files
      * - HUFFMAN for ".hcf" files
+     * - RANS for ".rans" files
      * - ERROR if none of the above match.
      */
     static AlgorithmEnum get_algorithm_from_name(const std::string &name, bool action);
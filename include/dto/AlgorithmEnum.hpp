@@ -14,6 +14,7 @@ enum class AlgorithmEnum {
     FRACTAL,       ///< Image compression via fractal algorithm (e.g., for .bmp/.jpg images).
     FLAC,          ///< Audio compression using FLAC-like algorithm (e.g., for .wav files).
     HUFFMAN,       ///< Generic data compression using Huffman coding (default or text files).
+    RANS,          ///< Generic data compression using rANS coding (selected with the "rans" option, ".rans" files).
     ERROR          ///< Indicates an unsupported or unrecognized algorithm type.
 };
 #endif
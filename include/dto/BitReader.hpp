@@ -0,0 +1,104 @@
+#ifndef ARCHIVATOR_BITREADER_HPP
+#define ARCHIVATOR_BITREADER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+
+/**
+ * @brief Word-at-a-time MSB-first bit reader.
+ *
+ * Reads streams produced by @ref BitWriter or @ref BitStream. The next unread bits are kept left-aligned in a 64-bit
+ * buffer that is refilled with one unaligned 8-byte load, so peek_bits()/skip_bits() are a shift and a subtraction
+ * in the common case.
+ *
+ * Reading past the end of the data yields zero bits; callers bound the read by a bit count known from the header
+ * (see bits_consumed()).
+ *
+ * A reader constructed over a stream pulls the data through a fixed-size buffer instead, so arbitrarily long streams
+ * are read in constant memory.
+ */
+class BitReader {
+public:
+    /**
+     * @brief Construct a reader over a byte range (the data is not copied and must outlive the reader).
+     * @param data Pointer to the first byte.
+     * @param size Number of bytes.
+     */
+    BitReader(const std::uint8_t *data, std::size_t size) : data_(data), size_(size) {}
+
+    /**
+     * @brief Construct a reader over a byte vector (the vector must outlive the reader).
+     */
+    explicit BitReader(const std::vector<std::uint8_t> &data) : BitReader(data.data(), data.size()) {}
+
+    /**
+     * @brief Construct a reader that pulls bytes from a stream (the stream must outlive the reader).
+     * @param source Stream positioned at the first byte of the bit stream.
+     * @param buffer_bytes Size of the fixed read buffer.
+     */
+    BitReader(std::istream &source, std::size_t buffer_bytes);
+
+    /**
+     * @brief Look at the next @p n bits without consuming them.
+     * @param n Number of bits, 0..56.
+     * @return The bits as an unsigned integer (first bit in the most significant position).
+     */
+    std::uint64_t peek_bits(unsigned n) {
+        if (avail_ < n) refill();
+        return (buf_ >> 1) >> (63 - n);
+    }
+
+    /**
+     * @brief Consume @p n bits.
+     * @param n Number of bits; must not exceed the amount made available by the preceding peek_bits().
+     */
+    void skip_bits(unsigned n) {
+        buf_ <<= n;
+        avail_ -= n;
+    }
+
+    /**
+     * @brief Read and consume the next @p n bits (0..56).
+     */
+    std::uint64_t get_bits(unsigned n) {
+        const std::uint64_t value = peek_bits(n);
+        skip_bits(n);
+        return value;
+    }
+
+    /**
+     * @brief Read and consume a single bit.
+     */
+    bool get_bit() { return get_bits(1) != 0; }
+
+    /**
+     * @brief Number of bits consumed so far.
+     */
+    std::size_t bits_consumed() const { return (base_ + pos_) * 8 - avail_; }
+
+    /**
+     * @brief Number of bits in the underlying data (for a stream reader: the bytes seen so far).
+     */
+    std::size_t bits_total() const { return (base_ + size_) * 8; }
+
+private:
+    /// Top the bit buffer up to at least 56 valid bits.
+    void refill();
+
+    /// Move the unread bytes to the front of @ref buffer_ and append as much of @ref source_ as fits.
+    void fill_buffer();
+
+    const std::uint8_t *data_;
+    std::size_t size_;
+    std::size_t pos_ = 0;    ///< Next byte to load (may run past @ref size_ when zero padding is fed in).
+    std::uint64_t buf_ = 0;  ///< Unread bits, left-aligned; bits below @ref avail_ are zero.
+    unsigned avail_ = 0;     ///< Number of valid bits in @ref buf_.
+
+    std::istream *source_ = nullptr;   ///< Stream still to be read (nullptr: memory reader or stream exhausted).
+    std::vector<std::uint8_t> buffer_; ///< Read buffer of a stream reader.
+    std::size_t base_ = 0;             ///< Stream offset of @ref data_[0].
+};
+
+#endif // ARCHIVATOR_BITREADER_HPP
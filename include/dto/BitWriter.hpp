@@ -0,0 +1,94 @@
+#ifndef ARCHIVATOR_BITWRITER_HPP
+#define ARCHIVATOR_BITWRITER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+/**
+ * @brief Word-at-a-time MSB-first bit writer.
+ *
+ * Produces the same byte layout as @ref BitStream (bit 0 is the MSB of the first byte), but collects bits in a
+ * 64-bit accumulator and commits them to the output 32 bits at a time instead of touching the byte vector for every bit.
+ *
+ * Typical usage:
+ * - Call put_bits()/put_bit() in sequence.
+ * - Call finish() once to flush the partial tail byte (zero padded) and take the bytes.
+ *
+ * A writer constructed with a sink stream keeps a fixed-size buffer instead and writes it to the sink each time it
+ * fills up, so arbitrarily long streams are produced in constant memory.
+ */
+class BitWriter {
+public:
+    /**
+     * @brief Construct an empty writer.
+     * @param reserve_bytes Expected output size in bytes; the buffer is allocated up front to avoid regrowth.
+     */
+    explicit BitWriter(std::size_t reserve_bytes = 0);
+
+    /**
+     * @brief Construct a writer that flushes to a stream.
+     * @param sink Stream that receives the bytes (must outlive the writer).
+     * @param buffer_bytes Size of the fixed output buffer.
+     */
+    BitWriter(std::ostream &sink, std::size_t buffer_bytes);
+
+    /**
+     * @brief Append the @p n low bits of @p value, most significant first.
+     * @param value Bits to append (bits above @p n are ignored).
+     * @param n Number of bits, 0..32.
+     */
+    void put_bits(std::uint64_t value, unsigned n) {
+        acc_ = (acc_ << n) | (value & ((std::uint64_t{1} << n) - 1));
+        bits_ += n;
+        if (bits_ >= 32) {
+            bits_ -= 32;
+            flush_word(static_cast<std::uint32_t>(acc_ >> bits_));
+        }
+    }
+
+    /**
+     * @brief Append a single bit.
+     * @param bit Logical value to append: false -> 0, true -> 1.
+     */
+    void put_bit(bool bit) { put_bits(bit, 1); }
+
+    /**
+     * @brief Total number of bits written so far (padding added by finish() is not counted).
+     */
+    std::size_t bit_count() const { return (flushed_ + size_) * 8 + bits_; }
+
+    /**
+     * @brief Flush the pending bits and return the encoded bytes.
+     * @return Byte buffer; the last byte is padded with zero bits if bit_count() is not a multiple of 8.
+     *         A writer with a sink writes the remaining bytes to it and returns an empty buffer.
+     *
+     * The writer is left empty and can be reused.
+     */
+    std::vector<std::uint8_t> finish();
+
+private:
+    /// Commit 32 bits (big-endian) to the byte buffer, making room first when it is full.
+    void flush_word(std::uint32_t word) {
+        if (size_ + 4 > data_.size()) make_room();
+        std::uint8_t *p = data_.data() + size_;
+        p[0] = static_cast<std::uint8_t>(word >> 24);
+        p[1] = static_cast<std::uint8_t>(word >> 16);
+        p[2] = static_cast<std::uint8_t>(word >> 8);
+        p[3] = static_cast<std::uint8_t>(word);
+        size_ += 4;
+    }
+
+    /// Drain the buffer to the sink, or grow it geometrically when there is none.
+    void make_room();
+
+    std::vector<std::uint8_t> data_; ///< Output buffer; only the first @ref size_ bytes are valid.
+    std::size_t size_ = 0;           ///< Number of committed bytes in @ref data_.
+    std::ostream *sink_ = nullptr;   ///< Destination of full buffers (nullptr: keep everything in memory).
+    std::size_t flushed_ = 0;        ///< Number of bytes already written to @ref sink_.
+    std::uint64_t acc_ = 0;          ///< Pending bits live in the low @ref bits_ bits.
+    unsigned bits_ = 0;              ///< Number of pending bits (always < 32 between calls).
+};
+
+#endif // ARCHIVATOR_BITWRITER_HPP
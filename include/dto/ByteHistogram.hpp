@@ -0,0 +1,48 @@
+#ifndef ARCHIVATOR_BYTE_HISTOGRAM_HPP
+#define ARCHIVATOR_BYTE_HISTOGRAM_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Byte frequency counting kernel.
+ *
+ * A plain `freq[c]++` loop stalls on store-to-load forwarding whenever the same byte repeats, because every increment
+ * waits for the previous one to reach memory. The kernels here spread consecutive bytes over several 32-bit
+ * sub-histograms so that neighbouring increments never hit the same counter, and merge the sub-histograms at the end.
+ *
+ * The implementation is picked once at run time from the CPU features (see best_kernel()).
+ */
+class ByteHistogram {
+public:
+    /**
+     * @brief Available counting kernels.
+     */
+    enum class Kernel {
+        Scalar,  ///< One histogram, one increment per byte (reference).
+        Generic, ///< Four interleaved sub-histograms fed from 8-byte loads; portable.
+        Avx2     ///< Eight interleaved sub-histograms fed from 32-byte loads; uniform 32-byte runs are counted with one vector compare.
+    };
+
+    /**
+     * @brief Add the byte frequencies of a buffer to @p freq.
+     * @param data First byte.
+     * @param size Number of bytes.
+     * @param freq Histogram of 256 counters; counts are added to the existing values.
+     */
+    static void count(const uint8_t *data, size_t size, uint64_t freq[256]);
+
+    /**
+     * @brief Same as count(), with an explicitly chosen kernel (for tests and benchmarks).
+     *
+     * A kernel the CPU does not support falls back to Kernel::Generic.
+     */
+    static void count(Kernel kernel, const uint8_t *data, size_t size, uint64_t freq[256]);
+
+    /**
+     * @brief Fastest kernel supported by the running CPU.
+     */
+    static Kernel best_kernel();
+};
+
+#endif // ARCHIVATOR_BYTE_HISTOGRAM_HPP
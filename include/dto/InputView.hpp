@@ -0,0 +1,66 @@
+#ifndef ARCHIVATOR_INPUT_VIEW_HPP
+#define ARCHIVATOR_INPUT_VIEW_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Read-only view of a whole input file.
+ *
+ * On POSIX systems the file is memory-mapped and advised for sequential access, so the codecs read it straight from the
+ * page cache without an intermediate copy or per-block system calls. Where mapping is unavailable or fails, the file is
+ * read into an owned buffer with one buffered read instead; callers see the same span either way.
+ */
+class InputView {
+public:
+    /**
+     * @brief Open and map (or read) a file.
+     * @param filename Path to the file.
+     *
+     * Check is_open() afterwards; an empty file is open and has an empty span.
+     */
+    explicit InputView(const std::string &filename);
+
+    /**
+     * @brief Unmap the file.
+     */
+    ~InputView();
+
+    InputView(const InputView &) = delete;
+    InputView &operator=(const InputView &) = delete;
+
+    /**
+     * @brief Whether the file could be opened.
+     */
+    bool is_open() const noexcept { return open_; }
+
+    /**
+     * @brief Contents of the file.
+     */
+    std::span<const uint8_t> bytes() const noexcept { return {data_, size_}; }
+
+    /**
+     * @brief Size of the file in bytes.
+     */
+    size_t size() const noexcept { return size_; }
+
+    /**
+     * @brief Whether the contents are memory-mapped (as opposed to read into a buffer).
+     */
+    bool is_mapped() const noexcept { return mapped_; }
+
+private:
+    /// Read the whole file into @ref buffer_ (fallback when it cannot be mapped).
+    void read_buffered(const std::string &filename);
+
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+    bool mapped_ = false;
+    std::vector<uint8_t> buffer_; ///< Owned contents when the file is not mapped.
+};
+
+#endif // ARCHIVATOR_INPUT_VIEW_HPP
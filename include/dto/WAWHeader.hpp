@@ -9,8 +9,8 @@
 /**
  * @brief Header of a WAV audio file (PCM format).
  *
- * This struct maps to the 44-byte WAV file header for PCM audio. It is used to read and validate WAV files
- * for the FLAC algorithm. **Note:** Only 16-bit PCM, mono audio is supported by this application.
+ * This struct maps to the canonical 44-byte WAV file header for PCM audio (fmt chunk of 16 bytes directly followed by the
+ * data chunk). FlacAlgo walks the RIFF chunks itself and does not rely on this layout.
  */
 struct WavHeader {
     char     chunk_id[4];     ///< File chunk ID (should be "RIFF").
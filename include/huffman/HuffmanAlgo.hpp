@@ -1,64 +1,86 @@
 #ifndef ARCHIVATOR_HUFFMAN_HPP
 #define ARCHIVATOR_HUFFMAN_HPP
 
-#include <map>
+#include <array>
+#include <span>
 #include <string>
 #include <controller/Controller.hpp>
-#include <dto/BitSteam.hpp>
+#include <dto/BitWriter.hpp>
+#include <dto/BitReader.hpp>
+#include <huffman/HuffmanTable.hpp>
+#include <parallel/ThreadPool.hpp>
 
 /**
  * @brief Huffman coding algorithm for general file compression.
  *
  * Provides methods to encode a file using Huffman coding and decode a Huffman-compressed file. This algorithm is suited for lossless compression of text or binary data.
- * The output format is a custom ".hcf" (Huffman Compressed File) containing the Huffman tree and encoded data.
+ * The output format is a custom ".hcf" (Huffman Compressed File) containing the code lengths and the canonically encoded data.
  */
 class HuffmanAlgo final : public IController {
+    /// Leading bytes of a version-2 .hcf file. Read as the size prefix of a version-1 file they would claim a payload of more than 10^17 bytes, so the two layouts cannot be confused.
+    static constexpr std::array<uint8_t, 8> kHcfMagicV2 = {0x89, 'H', 'C', 'F', '\r', '\n', 0x1A, 0x02};
+    /// Leading bytes of a version-3 (block mode) .hcf file.
+    static constexpr std::array<uint8_t, 8> kHcfMagicV3 = {0x89, 'H', 'C', 'F', '\r', '\n', 0x1A, 0x03};
+    /// Longest code the version-2 encoder emits.
+    static constexpr unsigned kMaxCodeLengthV2 = 15;
+    /// Size of the fixed read and write buffers used while streaming a file through the coder.
+    static constexpr size_t kStreamBufferBytes = 1 << 20;
+    /// Number of input bytes per independently coded block in version-3 files.
+    static constexpr uint32_t kBlockBytes = 1 << 21;
     /**
-         * @brief Internal node of the Huffman tree.
+         * @brief Huffman tree stored in a fixed node pool.
          *
-         * Represents a node in the Huffman binary tree, used during tree construction and traversal. Each node may have a character (for leaves), a frequency count, and pointers to left/right children.
+         * A tree over at most 256 leaves has at most 511 nodes, so all of them live in one array and children are referenced by
+         * index. Building or reading a tree performs no heap allocation, and the whole tree (about 8 KiB) stays in cache while codes are collected or walked.
          */
-    struct HuffmanNode {
-        /// Frequency of the character or sum of frequencies for an internal node.
-        uint32_t freq;
-        /// Data byte (valid only for leaf nodes; undefined for internal nodes where this may be 0).
-        unsigned char data;
-        /// Pointer to left child node (nullptr if leaf).
-        std::shared_ptr<HuffmanNode> left;
-        /// Pointer to right child node (nullptr if leaf).
-        std::shared_ptr<HuffmanNode> right;
+    struct HuffmanTree {
+        /// Child index marking a leaf.
+        static constexpr uint16_t kNone = 0xFFFF;
+        /// Capacity of the node pool: 256 leaves and 255 internal nodes.
+        static constexpr size_t kMaxNodes = 511;
 
         /**
-         * @brief Construct a HuffmanNode (leaf or internal).
-         * @param data Byte value (character) for a leaf node, or 0 for an internal node.
-         * @param frequency Frequency of occurrence (for leaves) or combined frequency (for internal nodes).
-         * @param left Pointer to left child (optional, for internal nodes).
-         * @param right Pointer to right child (optional, for internal nodes).
+         * @brief One node of the tree.
          */
-        explicit HuffmanNode(unsigned char data, uint32_t frequency, HuffmanNode *left=nullptr, HuffmanNode *right=nullptr) : freq(frequency),
-                                                                                                         data(data),
-                                                                                                         left(left),
-                                                                                                         right(right) {}
+        struct Node {
+            /// Frequency of the character or sum of frequencies for an internal node.
+            uint64_t freq;
+            /// Index of the left child (kNone for a leaf).
+            uint16_t left;
+            /// Index of the right child (kNone for a leaf).
+            uint16_t right;
+            /// Data byte (valid only for leaf nodes).
+            unsigned char data;
+        };
+
+        /// Node pool; only the first `size` entries are valid.
+        std::array<Node, kMaxNodes> nodes;
+        /// Number of nodes in use.
+        uint16_t size = 0;
+        /// Index of the root node (kNone for an empty tree).
+        uint16_t root = kNone;
+
         /**
-                 * @brief Comparator for prioritizing nodes in a min-heap.
-                 *
-                 * Enables using `std::shared_ptr<HuffmanNode>` in a priority queue sorted by frequency (smallest frequency has highest priority).
-                 */
-       struct Cmp {
-          bool operator()(const std::shared_ptr<HuffmanNode>& a,
-                          const std::shared_ptr<HuffmanNode>& b) const noexcept {
-            return a->freq > b->freq; // min-heap via greater
-          }};
+         * @brief Append a node to the pool.
+         * @return Index of the new node.
+         * @throws std::runtime_error if the pool is full (only possible for a malformed serialized tree).
+         */
+        uint16_t add(uint64_t freq, unsigned char data, uint16_t left = kNone, uint16_t right = kNone);
 
+        /**
+         * @brief Whether node @p i is a leaf.
+         */
+        bool is_leaf(uint16_t i) const { return nodes[i].left == kNone; }
     };
     /**
      * @brief Build a Huffman tree from frequency data.
      * @param freq A vector of size 256 containing frequency of each byte value (0-255).
-     * @return Root node of the constructed Huffman tree (as a shared_ptr), or nullptr if input is empty.
+     * @param tree Tree to fill; its root stays kNone if no byte occurs.
      *
-     * This static helper uses a min-heap to construct the optimal Huffman binary tree for the given frequency distribution.
+     * Sorts the used bytes by frequency and merges them with the two-queue method: leaves are taken from the sorted list, internal nodes
+     * are created in non-decreasing frequency order and so form a second sorted queue. The two smallest heads are merged until one node is left.
      */
-   static std::shared_ptr<HuffmanNode> build_huffman_tree(const std::vector<uint32_t>& freq);
+   static void build_huffman_tree(const std::vector<uint64_t>& freq, HuffmanTree &tree);
 
     /**
  * @brief Override: Send common info with "HuffmanAlgo" tag.
@@ -75,33 +97,77 @@ class HuffmanAlgo final : public IController {
        */
     void send_error_information(const std::string &error) override ;
   /**
-       * @brief Write a Huffman tree structure to a bit stream.
-       * @param root Root node of the Huffman tree.
-       * @param stream BitStream to write into.
+       * @brief Read a Huffman tree structure from a bit stream.
+       * @param stream BitReader to read from.
+       * @param tree Tree that receives the nodes.
+       * @return Index of the root of the subtree that was read.
+       * @throws std::runtime_error if the serialized tree has more nodes than a byte alphabet allows.
        *
-       * Performs a pre-order traversal of the Huffman tree and writes it into the bit stream in a serialized form.
-       * Leaf nodes are marked and followed by the byte data; internal nodes are marked and followed recursively by their children.
+       * Reads a serialized Huffman tree (pre-order: 1 + byte for a leaf, 0 + both subtrees for an internal node) from the stream and reconstructs the tree structure.
+       * This is used when decoding version-1 .hcf files, which store the tree instead of code lengths.
        */
-  static void write_tree_to_stream(const std::shared_ptr<HuffmanNode>& root, BitStream &stream) ;
+    static uint16_t read_tree_from_stream(BitReader &stream, HuffmanTree &tree);
   /**
-       * @brief Read a Huffman tree structure from a bit stream.
-       * @param stream BitStream to read from.
-       * @return Root node of the reconstructed Huffman tree.
+       * @brief Collect the code of every leaf into a flat code table.
+       * @param tree Huffman tree.
+       * @param node Index of the current node.
+       * @param code Code bits accumulated so far (right-aligned).
+       * @param depth Length of `code` in bits.
+       * @param table Table that receives one entry per leaf.
+       * @return `false` if some leaf is deeper than HuffmanDecodeTable::kMaxCodeLength (the table is then incomplete).
        *
-       * Reads a serialized Huffman tree (written by write_tree_to_stream) from the stream and reconstructs the tree structure.
-       * This is used during decoding to retrieve the original tree for bit interpretation.
+       * Used by the decoder to turn a serialized tree (canonical or not) into a lookup table.
        */
-    static std::shared_ptr<HuffmanNode> read_tree_from_stream(BitStream &stream);
+    static bool collect_codes(const HuffmanTree &tree, uint16_t node, uint32_t code, unsigned depth, HuffmanCodeTable &table);
   /**
-       * @brief Generate Huffman code strings for each byte.
-       * @param node Current node in the Huffman tree.
-       * @param code The prefix code string accumulated so far (use "" for initial call).
-       * @param codes Map from byte value to its Huffman code string, which will be populated by this function.
+       * @brief Compute length-limited code lengths for a byte histogram.
+       * @param freq A vector of size 256 containing frequency of each byte value (0-255).
+       * @param len Output code length per byte value (0 for bytes that do not occur).
        *
-       * Traverses the Huffman tree and assigns a code to each leaf (byte) found. Left edges add "0" and right edges add "1" to the code prefix.
-       * On completion, `codes` will contain an entry for each byte present in the tree, mapping to its binary string code.
+       * Builds the Huffman tree, takes the leaf depths and limits them to kMaxCodeLengthV2 bits (HuffmanCodeTable::limit_lengths).
+       * A single used byte gets a 1-bit code so that every symbol costs at least one bit.
+       */
+    static void compute_code_lengths(const std::vector<uint64_t>& freq, uint8_t len[256]);
+  /**
+       * @brief Collect the depth of every leaf of a Huffman tree.
+       * @param tree Huffman tree.
+       * @param node Index of the current node.
+       * @param depth Depth of `node` (0 for the root).
+       * @param len Output depth per byte value; entries of bytes without a leaf are left untouched.
+       */
+    static void collect_code_lengths(const HuffmanTree &tree, uint16_t node, unsigned depth, uint8_t len[256]);
+  /**
+       * @brief Write 256 code lengths of 4 bits each.
+       */
+    static void write_code_lengths(BitWriter &stream, const uint8_t len[256]);
+  /**
+       * @brief Read 256 code lengths of 4 bits each.
        */
-    static void generate_codes(const  std::shared_ptr<HuffmanNode>& node, const std::string &code, std::map<unsigned char, std::string> &codes);
+    static void read_code_lengths(BitReader &stream, uint8_t len[256]);
+  /**
+       * @brief Encode one block of a version-3 file.
+       * @param data First input byte of the block.
+       * @param size Number of input bytes.
+       * @return The block's own code lengths followed by its canonical codes, zero padded to a whole byte.
+       *
+       * Depends on nothing but the block content, so blocks can be coded on any thread in any order.
+       */
+    static std::vector<uint8_t> encode_block(const uint8_t *data, size_t size);
+  /**
+       * @brief Decode one block of a version-3 file.
+       * @param packed Bytes produced by encode_block().
+       * @param plain Output buffer, already sized to the number of bytes in the block.
+       * @throws std::runtime_error if the block is corrupt.
+       */
+    static void decode_block(std::span<const uint8_t> packed, std::vector<uint8_t> &plain);
+  /**
+       * @brief Decode the body of a version-3 file.
+       * @param data Rest of the file after the magic.
+       * @param out Destination of the decoded bytes.
+       * @param threads Number of worker threads (0 = one per hardware thread).
+       * @throws std::runtime_error if the header is inconsistent or a block is corrupt.
+       */
+    static void decode_blocks(std::span<const uint8_t> data, std::ostream &out, unsigned threads);
 
 public:
   /**
@@ -120,24 +186,44 @@ public:
        * @param size_input1 Optional precomputed input size (if -1, the size will be determined automatically).
        * @param duration1 Optional accumulated duration in milliseconds to add (use 0 for none).
        *
-       * Reads the entire input file, computes frequency of each byte, builds the Huffman tree, and writes out a compressed file in "storageEncoded" with extension ".hcf".
-       * The compressed file begins with the size of the encoded data, a padding byte count, followed by the serialized Huffman tree and the bit-coded content.
+       * Reads the input through an InputView (memory-mapped where possible) in two passes: the first computes the frequency of each byte (ByteHistogram), the second emits the codes into a BitWriter that flushes to the output file whenever its fixed kStreamBufferBytes buffer fills up.
+       * No copy of the input is made, so the heap footprint does not depend on the input size. The compressed file is written to "storageEncoded" with extension ".hcf".
+       * The file uses the version-2 layout: `kHcfMagicV2`, the number of encoded bytes (uint64), 256 code lengths of 4 bits each, then the canonical codes of the content.
+       * Code lengths are limited to kMaxCodeLengthV2 bits, and codes are emitted from a flat HuffmanCodeTable.
        * On success, writes a message with the output file path; on failure to write output, sends an error and terminates the program.
        * Also calculates compression ratio and time, and outputs them via `send_common_information`.
        */
     void encode(const std::string &input_filename, const std::string &mod = "Huffman",int size_input1=-1,long duration1=0);
 
+  /**
+       * @brief Compress a file using block-parallel Huffman coding.
+       * @param input_filename Path to the input file to compress.
+       * @param threads Number of worker threads (0 = one per hardware thread).
+       *
+       * Splits the input into kBlockBytes blocks, each with its own code table, and codes them on a ThreadPool.
+       * The file uses the version-3 layout: `kHcfMagicV3`, the number of encoded bytes (uint64), the block size (uint32),
+       * the number of blocks (uint32), the compressed size of every block (uint64 each), then the blocks themselves
+       * (see encode_block()). Every block can be decoded on its own, and the output does not depend on @p threads.
+       * Blocks are slices of an InputView of the input; they are coded a few per worker at a time, so the heap footprint grows with the thread count rather than the input size.
+       * The compressed file is written to "storageEncoded" with extension ".hcf"; on failure to write output, sends an error and terminates the program.
+       */
+    void encode_blocks(const std::string &input_filename, unsigned threads = 0);
+
 
   /**
        * @brief Decompress a Huffman-compressed file.
        * @param input_filename Path to the ".hcf" file to decompress.
+       * @param threads Number of worker threads for version-3 files (0 = one per hardware thread).
        *
-       * Reads the Huffman tree and encoded data from the given file, reconstructs the original content, and writes it to "storageDecoded/" with the original filename (extension removed).
+       * Reads the code description and encoded data from the given file, reconstructs the original content, and writes it to "storageDecoded/" with the original filename (extension removed).
+       * Version-2 files rebuild the canonical codes from the stored lengths. Version-3 (block mode) files are decoded in parallel on @p threads workers. Version-1 files (size, padding byte, serialized tree) are still accepted.
+       * Codes are resolved with a HuffmanDecodeTable (up to two symbols per lookup) and written out in blocks; version-1 trees deeper than the table supports fall back to a bit-by-bit tree walk.
+       * The compressed file is read through an InputView (memory-mapped where possible) and decoded in place, without copying it to the heap.
        * The output file is the exact original data prior to compression.
        * This method measures the time and size information and outputs the compression ratio (which should match original compression) and other metrics.
        * If any file operation fails (e.g., cannot open output), an error is logged and the program may terminate.
        */
-    void decode(const std::string &input_filename);
+    void decode(const std::string &input_filename, unsigned threads = 0);
 };
 
 #endif
\ No newline at end of file
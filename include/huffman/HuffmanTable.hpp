@@ -0,0 +1,120 @@
+#ifndef ARCHIVATOR_HUFFMAN_TABLE_HPP
+#define ARCHIVATOR_HUFFMAN_TABLE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include <dto/BitReader.hpp>
+
+/**
+ * @brief Flat per-symbol prefix code table.
+ *
+ * `code[s]` holds the `len[s]` low bits of the code for byte `s` (first bit most significant); `len[s] == 0` marks a
+ * byte that does not occur in the input.
+ */
+struct HuffmanCodeTable {
+    uint32_t code[256]{}; ///< Code bits, right-aligned.
+    uint8_t len[256]{};   ///< Code length in bits (0 = symbol unused).
+
+    /**
+     * @brief Assign canonical codes to a set of code lengths.
+     * @param len Code length for each of the 256 byte values (0 = unused); all lengths must be <= 32.
+     * @return Table where codes of equal length are consecutive integers in symbol order and shorter codes sort before longer ones.
+     *
+     * Canonical codes are fully determined by the lengths, so a decoder only needs the lengths to rebuild them.
+     */
+    static HuffmanCodeTable canonical(const uint8_t len[256]);
+
+    /**
+     * @brief Limit code lengths to @p max_len bits, keeping the code complete.
+     * @param len Code length for each byte value (0 = unused); updated in place.
+     * @param freq Frequency of each byte value, used to give the shorter codes to the more frequent bytes.
+     * @param max_len Maximum allowed length.
+     *
+     * Uses the length-count adjustment from JPEG (ITU T.81, Annex K.3): each pair of over-long codes is merged one level up
+     * and a shorter code is split to make room, then the new lengths are handed out in order of decreasing frequency.
+     * Does nothing if the lengths already fit.
+     */
+    static void limit_lengths(uint8_t len[256], const uint64_t freq[256], unsigned max_len);
+};
+
+/**
+ * @brief Lookup-table Huffman decoder.
+ *
+ * A primary table indexed by the next @ref kPrimaryBits bits of the stream resolves every code up to that length in one
+ * lookup, and packs a second symbol into the same entry whenever both codes fit into the window. Longer codes go
+ * through a per-prefix overflow table indexed by the remaining bits.
+ */
+class HuffmanDecodeTable {
+public:
+    /// Width of the primary lookup window.
+    static constexpr unsigned kPrimaryBits = 11;
+    /// Longest code the table decoder accepts (primary window + overflow window).
+    static constexpr unsigned kMaxCodeLength = 20;
+
+    /**
+     * @brief Build the lookup tables for a prefix code.
+     * @param codes Code table (need not be canonical, but must be prefix-free).
+     * @return `false` if some code is longer than @ref kMaxCodeLength or the lengths oversubscribe the code space
+     * (Σ2^-len > 1, which no prefix code can satisfy); the table is then unusable. Lengths read from a file must be
+     * checked this way before their canonical codes are used.
+     */
+    bool build(const HuffmanCodeTable &codes);
+
+    /**
+     * @brief Decode symbols until the reader has consumed @p end_bit bits and write them to @p out.
+     * @param reader Bit reader positioned at the first code.
+     * @param end_bit Stream position (in bits) right after the last code.
+     * @param out Destination stream; symbols are collected in a fixed-size block before each write.
+     *
+     * @throws std::runtime_error if the stream contains a bit pattern that is not a valid code.
+     */
+    void decode(BitReader &reader, size_t end_bit, std::ostream &out) const;
+
+    /**
+     * @brief Decode exactly @p count symbols and write them to @p out.
+     * @param reader Bit reader positioned at the first code.
+     * @param count Number of symbols to decode.
+     * @param out Destination stream; symbols are collected in a fixed-size block before each write.
+     *
+     * Used when the header stores the symbol count rather than the payload length in bits.
+     * @throws std::runtime_error if the stream contains a bit pattern that is not a valid code.
+     */
+    void decode_symbols(BitReader &reader, uint64_t count, std::ostream &out) const;
+
+    /**
+     * @brief Decode exactly @p count symbols into a memory buffer.
+     * @param reader Bit reader positioned at the first code.
+     * @param count Number of symbols to decode.
+     * @param out Destination with room for @p count bytes.
+     *
+     * @throws std::runtime_error if the stream contains a bit pattern that is not a valid code.
+     */
+    void decode_symbols(BitReader &reader, size_t count, uint8_t *out) const;
+
+private:
+    /**
+     * @brief One lookup result.
+     *
+     * For decoded entries `count` is 1 or 2 and `total_len` is the number of bits consumed by all symbols.
+     * For links `count` is 0, `sub_bits` is the overflow window width and `sub_offset` points into @ref overflow_.
+     * Entries with `count == 0 && sub_bits == 0` are not reachable by any valid code.
+     */
+    struct Entry {
+        uint8_t symbols[2]{};
+        uint8_t count = 0;
+        uint8_t first_len = 0;
+        uint8_t total_len = 0;
+        uint8_t sub_bits = 0;
+        uint16_t sub_offset = 0;
+    };
+
+    /// Decode exactly one symbol, never looking at bits past @p end_bit for the pair shortcut.
+    bool decode_one(BitReader &reader, size_t end_bit, uint8_t &symbol) const;
+
+    std::vector<Entry> primary_;
+    std::vector<Entry> overflow_;
+};
+
+#endif // ARCHIVATOR_HUFFMAN_TABLE_HPP
@@ -0,0 +1,67 @@
+#ifndef ARCHIVATOR_DOMAIN_INDEX_HPP
+#define ARCHIVATOR_DOMAIN_INDEX_HPP
+
+#include <array>
+#include <cstddef>
+#include <vector>
+#include <image/Image.hpp> // pixel_value
+#include <image/DomainPool.hpp>
+
+/**
+ * @brief KD-tree over the domains of a DomainPool for nearest-neighbour matching (Saupe's method).
+ *
+ * With the least-squares scale, the error of fitting domain `d` to range block `r` is `|r - r̄|² (1 - <r̂, d̂>²)`, where `x̂` is the
+ * mean-removed block scaled to unit length. The best domain is therefore the one whose `d̂` or `-d̂` lies nearest to `r̂`.
+ * Blocks are reduced to a feature vector of at most kFeatureSide x kFeatureSide cell averages before normalizing, and the tree holds
+ * both `d̂` and `-d̂` of every domain with some variance. A query returns the domains of the k nearest points; the caller fits those
+ * exactly (DomainPool::fit()), so a larger k trades encode time for matches closer to a full search.
+ */
+class DomainIndex {
+public:
+    /// Cells per side of a feature vector (fewer for smaller blocks).
+    static constexpr int kFeatureSide = 4;
+    /// Largest feature dimension.
+    static constexpr int kMaxDimension = kFeatureSide * kFeatureSide;
+
+    using Feature = std::array<float, kMaxDimension>;
+
+    /**
+     * @brief Index the domains of @p pool; the features are copied, so the index does not refer to the pool afterwards.
+     */
+    explicit DomainIndex(const DomainPool &pool);
+
+    /**
+     * @brief Normalized, mean-removed feature of a block.
+     * @param block Top-left pixel.
+     * @param stride Width of the plane @p block points into.
+     * @param block_size Width and height of the block.
+     * @param out Feature; the first `dimension(block_size)` entries are written.
+     * @return false if the block is flat (no feature exists).
+     */
+    static bool feature(const pixel_value *block, int stride, int block_size, Feature &out) noexcept;
+
+    /// Number of feature entries used for blocks of @p block_size.
+    static int dimension(int block_size) noexcept;
+
+    /**
+     * @brief Domains of the @p k points nearest to the feature of a range block, in increasing order and without repetitions.
+     * @return Empty if the range block is flat or no domain has any variance; any domain fits a flat block equally well.
+     */
+    std::vector<int> nearest(const pixel_value *range, int range_stride, size_t k) const;
+
+private:
+    struct Point {
+        Feature feature;
+        int domain;
+    };
+
+    /// Sort points [first, last) into a balanced tree: the median along the widest axis at the middle, subtrees on either side.
+    void build(size_t first, size_t last);
+
+    int block_size_;
+    int dimension_;
+    std::vector<Point> points_;
+    std::vector<unsigned char> axis_; ///< Split axis of the node stored at each position.
+};
+
+#endif // ARCHIVATOR_DOMAIN_INDEX_HPP
@@ -0,0 +1,121 @@
+#ifndef ARCHIVATOR_DOMAIN_POOL_HPP
+#define ARCHIVATOR_DOMAIN_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <image/Image.hpp> // pixel_value
+
+/**
+ * @brief Domain blocks of one channel for one range block size, ready for matching.
+ *
+ * A domain for range blocks of size `N` is a `2N x 2N` square of the image at a multiple of `2N` (see QuadTreeEncoder::domain_grid()),
+ * i.e. an `N x N` tile of the 2x down-sampled plane. The pool copies every tile into one contiguous array, in raster order of the tiles,
+ * and stores the sum and the sum of squares of its pixels, so that matching a range block against a domain needs only the dot product Σrd.
+ * Domains are also grouped by classify(), so a search can be restricted to the domains that have the same coarse shape as the range block.
+ */
+class DomainPool {
+public:
+    /**
+     * @brief Least-squares fit of a domain to a range block.
+     */
+    struct Fit {
+        int scale_index;  ///< Quantized scale (IFSTransform::quantize_scale()).
+        int offset_index; ///< Quantized offset (IFSTransform::quantize_offset()).
+        double scale;     ///< Scale of scale_index.
+        int offset;       ///< Offset of offset_index.
+        double error;     ///< Mean squared error of `scale * d + offset` against the range block.
+    };
+
+    /// Number of classes of classify(): 24 brightness orderings of the quadrants times the quadrant with the largest variance.
+    static constexpr int kClasses = 24 * 4;
+
+    /**
+     * @brief Class of a block, in the style of Fisher's quadrant classification.
+     * @param block Top-left pixel of the block.
+     * @param stride Width of the plane @p block points into.
+     * @param block_size Width and height of the block (even).
+     * @return `ordering * 4 + quadrant`: the rank (0..23) of the permutation that sorts the quadrants by decreasing mean,
+     * and the quadrant (0..3, raster order) with the largest variance.
+     *
+     * Fisher also folds the orientation into the class by rotating each block to a canonical one; the encoder does not try
+     * symmetries, so here the orientation stays part of the class. A positive scale keeps the brightness ordering, a negative
+     * one reverses it (inverse_class()); neither changes the most varied quadrant.
+     */
+    static int classify(const pixel_value *block, int stride, int block_size) noexcept;
+
+    /**
+     * @brief Class of the same block with its brightness negated (the quadrant ordering reversed).
+     */
+    static int inverse_class(int block_class) noexcept;
+
+    /**
+     * @brief Classes next to @p block_class: the same ordering with any most varied quadrant, and the orderings one
+     * swap of two adjacent ranks away with the same quadrant (includes @p block_class itself).
+     */
+    static std::vector<int> neighbour_classes(int block_class);
+
+    /**
+     * @brief Cut the domains out of a down-sampled plane.
+     * @param down_plane Down-sampled channel (IFSTransform::down_sample() of the whole plane).
+     * @param down_width Width and height of @p down_plane.
+     * @param block_size Range block size `N`; domains are the `N x N` tiles of @p down_plane.
+     */
+    DomainPool(const pixel_value *down_plane, int down_width, int block_size);
+
+    /// Range block size the pool was built for.
+    int block_size() const noexcept { return block_size_; }
+
+    /// Number of domains per row and column (QuadTreeEncoder::domain_grid()).
+    int grid() const noexcept { return grid_; }
+
+    /// Number of domains.
+    int size() const noexcept { return grid_ * grid_; }
+
+    /// Pixels of domain @p i, `block_size() * block_size()` of them row by row.
+    const pixel_value *pixels(int i) const noexcept { return pixels_.data() + static_cast<size_t>(i) * area_; }
+
+    /// Indices of the domains of class @p block_class (classify()), in increasing order.
+    const std::vector<int> &members(int block_class) const noexcept { return members_[static_cast<size_t>(block_class)]; }
+
+    /// Σd over domain @p i.
+    int64_t sum(int i) const noexcept { return sum_[static_cast<size_t>(i)]; }
+
+    /// Σd² over domain @p i.
+    int64_t sum_sq(int i) const noexcept { return sum_sq_[static_cast<size_t>(i)]; }
+
+    /// X-coordinate of domain @p i in the full-size image (IFSTransform::from_x).
+    int x(int i) const noexcept { return i % grid_ * 2 * block_size_; }
+
+    /// Y-coordinate of domain @p i in the full-size image (IFSTransform::from_y).
+    int y(int i) const noexcept { return i / grid_ * 2 * block_size_; }
+
+    /**
+     * @brief Σrd of a range block and domain @p i.
+     * @param range Top-left pixel of the range block.
+     * @param range_stride Width of the plane @p range points into.
+     */
+    int64_t dot(const pixel_value *range, int range_stride, int i) const noexcept;
+
+    /**
+     * @brief Fit domain @p i to a range block with the given sums.
+     * @param sum_r Σr of the range block.
+     * @param sum_rr Σr² of the range block.
+     * @param sum_rd Σrd of the range block and the domain (dot()).
+     *
+     * Scale and offset are the least-squares solution rounded to what a .fic file can store; the error is evaluated in closed form
+     * with the rounded values, so it is the error the decoder will see (up to clamping to 0..255).
+     */
+    Fit fit(int i, int64_t sum_r, int64_t sum_rr, int64_t sum_rd) const noexcept;
+
+private:
+    int block_size_;
+    int area_;
+    int grid_;
+    std::vector<pixel_value> pixels_;
+    std::vector<int64_t> sum_;
+    std::vector<int64_t> sum_sq_;
+    std::vector<std::vector<int>> members_;
+};
+
+#endif // ARCHIVATOR_DOMAIN_POOL_HPP
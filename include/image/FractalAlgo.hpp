@@ -5,19 +5,31 @@
 #ifndef ARCHIVATOR_FRACTAL_ALGO_HPP
 #define ARCHIVATOR_FRACTAL_ALGO_HPP
 
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
 #include <string>
+#include <dto/BitWriter.hpp>
+#include <dto/BitReader.hpp>
 #include <image/Image.hpp>
+#include <image/IFSTransform.hpp>
+#include <image/QuadTreeEncoder.hpp>
 #include <controller/IController.hpp>
 
 namespace fs = std::filesystem;
 /**
  * @brief High-level fractal compression algorithm for images.
  *
- * Coordinates the fractal encoding of an image and subsequent Huffman compression of the encoded data. The fractal algorithm divides the image into range blocks and represents them via self-similar transforms (IFS), then uses multiple decoding iterations to construct an approximate image which is further compressed. This algorithm is typically used for image files (e.g., BMP, JPEG).
- *
- * @note This implementation uses an intermediate Huffman encoding stage: the fractal-approximated image is compressed using Huffman coding to produce the final output file (with extension ".hcf"). Direct fractal data output is not saved separately.
+ * Coordinates the fractal encoding of an image into a ".fic" archive and its decoding. The fractal algorithm divides the image into range blocks and represents them via self-similar transforms (IFS);
+ * the archive stores only those transforms, bit-packed, and the decoder reconstructs the image by iterating them from a grey start image. This algorithm is typically used for image files (e.g., BMP, JPEG).
  */
 class FractalAlgo final : public IController {
+    /// Version of the .fic layout; stored as the last byte of kFicMagic.
+    static constexpr uint8_t kFicFormatVersion = 1;
+    /// Leading bytes of a .fic file.
+    static constexpr std::array<uint8_t, 8> kFicMagic = {0x89, 'A', 'F', 'I', '\r', '\n', 0x1A, kFicFormatVersion};
+
     /**
      * @brief Override: Tag and send compression summary for fractal algorithm.
      * @param common_information Compression metrics (ratio, time, sizes).
@@ -54,6 +66,28 @@ class FractalAlgo final : public IController {
      */
     void send_decoded_information(int width, int height, int phases) const;
 
+    /**
+     * @brief Bits of a stored domain index for range blocks of @p block_size (enough for all QuadTreeEncoder::domain_grid() domains).
+     */
+    static unsigned domain_bits(int image_size, int block_size);
+
+    /**
+     * @brief Write the transforms of one quadtree node and its children.
+     * @param leaves Transforms of the channel, in the order QuadTreeEncoder produces them (depth first, quadrants in the order top-left, top-right, bottom-left, bottom-right).
+     * @param next Index of the first leaf not written yet; advanced past the leaves of this node.
+     *
+     * A node larger than 2 pixels starts with a split flag; a leaf then stores its domain index, symmetry, scale and
+     * offset (see IFSTransform::kScaleBits and the neighbouring constants).
+     * @throws std::runtime_error if the leaves do not tile the node.
+     */
+    static void write_node(BitWriter &stream, const transform &leaves, size_t &next, int x, int y, int block_size, int image_size);
+
+    /**
+     * @brief Read a quadtree node written by write_node() and append its leaves to @p out.
+     * @throws std::runtime_error if a stored value is out of range.
+     */
+    static void read_node(BitReader &stream, transform &out, int x, int y, int block_size, int image_size);
+
 public:
     /**
      * @brief Constructs the Fractal algorithm handler.
@@ -64,18 +98,39 @@ public:
     explicit FractalAlgo(bool is_text_output, const std::string &output_file, std::ostringstream &ref_oss)
         : IController(is_text_output, output_file, ref_oss) {}
 
+    /// Decoding iterations run by decode() unless told otherwise.
+    static constexpr int kDecodePhases = 8;
+
     /**
      * @brief Compress an image using fractal compression.
      * @param input_filename Path to the input image file.
      * @param quality Quality parameter controlling compression accuracy (e.g., 100 is default; lower values produce higher quality at expense of compression).
+     * @param threads Number of worker threads for the block search (0 = one per hardware thread); the output does not depend on it.
+     * @param search Domains compared with each range block (see DomainSearch): fewer is faster, more may find better matches.
+     * @param nearest Domains fitted per range block by DomainSearch::Nearest.
      *
-     * Performs fractal compression on the image file. It loads the image, optionally adjusts quality settings, and encodes the image via the QuadTreeEncoder to obtain IFS transforms. It then runs a few decoding iterations on those transforms to produce an approximate image. The resulting approximate image is saved to a temporary file, which is then compressed using Huffman coding (via HuffmanAlgo) into the final output (stored in "storageEncoded/" with extension ".hcf"). The temporary image file is removed after Huffman encoding.
+     * Loads the image (padded to a square whose side is a multiple of 32) and encodes it with the QuadTreeEncoder into IFS transforms. The transforms are written to "storageEncoded/" with the extension ".fic":
+     * `kFicMagic`, the image width and height before padding (uint16 each), the padded side (uint16), the channel count and the root block size (uint8 each),
+     * the original extension (uint8 length and the characters), then a bit stream with, for each channel and each root block in raster order, its quadtree (see write_node()).
      *
-     * The method reports progress and info: starts with a message "Encoding..." and after completion, outputs compression ratio and time via `send_common_information`. It also logs intermediate details like the number of transforms and phases of decoding internally.
+     * The method reports progress and info: starts with a message "Encoding..." and after completion, outputs the number of transforms, the compression ratio and time via `send_common_information`.
      *
      * @throws std::runtime_error If image loading fails or an unsupported image format is encountered (propagated from Image class).
      */
-    void encode(const std::string &input_filename, int quality) const;
+    void encode(const std::string &input_filename, int quality, unsigned threads = 0, DomainSearch search = DomainSearch::Neighbours,
+                unsigned nearest = QuadTreeEncoder::kNearestDomains);
+
+    /**
+     * @brief Decompress a ".fic" archive.
+     * @param input_filename Path to the .fic file.
+     * @param phases Number of decoding iterations.
+     *
+     * Reads the transforms and applies all of them @p phases times to a grey image of the padded size (see Decoder); each iteration brings the image closer to the attractor of the transforms.
+     * The result is cropped to the original size and saved to "storageDecoded/" with the original extension.
+     *
+     * @throws std::runtime_error If the file cannot be read, is not a .fic file of this version or is corrupt.
+     */
+    void decode(const std::string &input_filename, int phases = kDecodePhases);
 };
 
 
@@ -42,6 +42,25 @@ public:
     double scale;    ///< Scale factor for pixel intensities (brightness scaling).
     int    offset;   ///< Additive offset for pixel intensities after scaling.
 
+    // Quantization of scale and offset, as stored in a .fic file. The encoder only produces representable values,
+    // so a stored transform decodes exactly as the encoder evaluated it.
+    static constexpr unsigned kSymmetryBits = 3; ///< Bits of a stored Sym.
+    static constexpr unsigned kScaleBits = 5;    ///< Bits of a stored scale.
+    static constexpr int kScaleSteps = 15;       ///< Scales are multiples of 1/kScaleSteps in [-1, 1] (|scale| <= 1 keeps the decoder converging).
+    static constexpr unsigned kOffsetBits = 8;   ///< Bits of a stored offset.
+    static constexpr int kMinOffset = -255;      ///< Smallest offset (scale 1, black range, white domain).
+    static constexpr int kOffsetStep = 3;        ///< Offsets are kMinOffset + k * kOffsetStep, covering [-255, 510].
+    static_assert(2 * kScaleSteps < (1 << kScaleBits));
+
+    /// Index of the representable scale nearest to @p scale (clamped to [-1, 1]).
+    static int quantize_scale(double scale) noexcept;
+    /// Scale of index @p q.
+    static double dequantize_scale(int q) noexcept { return static_cast<double>(q - kScaleSteps) / kScaleSteps; }
+    /// Index of the representable offset nearest to @p offset (clamped).
+    static int quantize_offset(int offset) noexcept;
+    /// Offset of index @p q.
+    static int dequantize_offset(int q) noexcept { return kMinOffset + q * kOffsetStep; }
+
     /**
      * @brief Down-sample a block of pixels by 2x.
      * @param src Pointer to the source image data (assumed at least `src_width * src_width` in size).
@@ -30,6 +30,10 @@ public:
     std::string extension;
     /// Original image size in bytes (width * height * channels before any padding).
     int original_size = 0;
+    /// Width of the image as stored in the file, before load() padded it.
+    int source_width = 0;
+    /// Height of the image as stored in the file, before load() padded it.
+    int source_height = 0;
 
     /**
      * @brief Constructs an Image object.
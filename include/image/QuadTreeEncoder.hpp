@@ -5,12 +5,26 @@
 #include <memory>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <image/Image.hpp>
 #include <image/IFSTransform.hpp>
+#include <image/DomainPool.hpp>
+#include <image/DomainIndex.hpp>
 #include <image/Encoder.hpp>
 
 #define BUFFER_SIZE (32)
+
+/**
+ * @brief Which domains QuadTreeEncoder compares a range block with.
+ */
+enum class DomainSearch {
+    Full,       ///< Every domain of the block size.
+    Class,      ///< Domains of the range block's class and of its inverse (DomainPool::classify(), DomainPool::inverse_class()).
+    Neighbours, ///< Class plus the neighbouring classes of both (DomainPool::neighbour_classes()).
+    Nearest,    ///< The domains nearest to the range block in a DomainIndex.
+};
+
 /**
  * @brief Fractal image encoder using quadtree partitioning.
  *
@@ -18,19 +32,31 @@
  */
 class QuadTreeEncoder final : public Encoder {
 public:
+    /// Default number of index points fitted per range block by DomainSearch::Nearest.
+    static constexpr unsigned kNearestDomains = 16;
+
     /**
      * @brief Constructs the quadtree-based fractal encoder.
      * @param is_text_output If true, enable text output for messages; if false, output to file.
      * @param output_file Path to output file (if not in text mode).
      * @param ref_oss Reference to text output stream.
      * @param quality Quality threshold (integer, typically 0–100). Higher values allow more error per block (fewer splits), lower values enforce less error (more splits).
+     * @param threads Number of worker threads for encode() (0 = one per hardware thread).
+     * @param search Domains compared with each range block; a class search falls back to all domains when the classes are empty.
+     * @param nearest Number of index points a DomainSearch::Nearest search fits (its quality knob: more is slower and closer to a full search).
      */
     explicit QuadTreeEncoder(bool is_text_output,
                              const std::string &output_file,
                              std::ostringstream &ref_oss,
-                             int quality = 100)
+                             int quality = 100,
+                             unsigned threads = 0,
+                             DomainSearch search = DomainSearch::Neighbours,
+                             unsigned nearest = kNearestDomains)
         : Encoder(is_text_output, output_file, ref_oss)
-        , quality_(quality) {}
+        , quality_(quality)
+        , threads_(threads)
+        , search_(search)
+        , nearest_(nearest) {}
 
     ~QuadTreeEncoder() override = default;
 
@@ -41,14 +67,24 @@ public:
      *
      * This method first prepares internal image metadata from `source`, then for each channel:
      * - Copies channel data into a local buffer (`range`).
-     * - Creates a half-sized version (`down`) of the image for domain blocks using IFSTransform::down_sample.
+     * - Creates a half-sized version of the image with IFSTransform::down_sample and cuts it into a DomainPool for every block size.
      * - Iterates over the image in blocks (e.g., 32x32 by default) and calls `find_matches_for` on each block.
+     * The top-level blocks of all channels are searched in parallel on a ThreadPool, each into its own transform list; the lists are
+     * concatenated in raster order per channel, so the result is the same for any number of threads.
      * The result is a set of transforms that map domains to approximate each range block. If a block cannot be approximated within the `quality` threshold, it is recursively split into four smaller blocks (quadtree subdivision).
      *
      * @throws std::invalid_argument if the source image has invalid metadata (e.g., width/height <= 0 or unsupported channels).
      */
     std::unique_ptr<Transforms> encode(const Image &source) override;
 
+    /**
+     * @brief Number of domain blocks per row (and column) for range blocks of @p block_size in a square image of side @p image_size.
+     *
+     * Domains are the `2 * block_size` squares at multiples of `2 * block_size` that lie entirely inside the image; domain
+     * `i` of a block size has its top-left corner at `((i % n) * 2 * block_size, (i / n) * 2 * block_size)`.
+     */
+    static int domain_grid(int image_size, int block_size) noexcept { return image_size / (2 * block_size); }
+
 private:
     /**
      * @brief Find the best matching domain block for a given range block (and possibly subdivide).
@@ -58,27 +94,33 @@ private:
      * @param block_size Size (width and height) of the current range block.
      * @param range_plane Pointer to the range image data (for one channel).
      * @param range_stride Width of the range image.
-     * @param down_plane Pointer to the down-sampled image data (domain pool) for the same channel.
-     * @param down_stride Width of the down-sampled image.
-     * @param image_height Height of the full image (used to limit domain search).
+     * @param domains Domain pools of the same channel, one per block size from BUFFER_SIZE down to 2.
+     * @param index Indices of those pools (only used, and only built, for DomainSearch::Nearest).
      *
-     * For the given range block defined by `(to_x, to_y, block_size)`, this function searches through the down-sampled image (`down_plane`) for a domain block that best matches. It evaluates all possible domain blocks (of size block_size) in the down-sampled image by:
-     * - Applying no symmetry (initially) and computing average, scale, offset, and error.
+     * For the given range block defined by `(to_x, to_y, block_size)`, this function computes Σr and Σr² once and then fits the domains
+     * of the pool for `block_size` selected by the search mode (DomainPool::fit()), which costs one dot product Σrd per domain.
      * - (NOTE: In the current implementation, only `SYM_NONE` is tried for simplicity; extension to try other Sym values could be added).
      * It keeps track of the best match (minimum error). If the best error is above the quality threshold and the block can be subdivided (block_size > 2), it splits the range block into four smaller blocks and recursively finds matches for those sub-blocks.
      * Otherwise, it records an IFSTransform for the best match (with appropriate parameters).
+     * It does not modify the encoder, so calls for different range blocks may run concurrently.
      *
-     * @throws std::invalid_argument if any input pointers (`range_plane` or `down_plane`) are null or if `block_size` or strides are invalid.
+     * @throws std::invalid_argument if `range_plane` is null, or if `block_size`, `range_stride` or `domains` are invalid.
      */
     void find_matches_for(transform &out,
                           int to_x, int to_y,
                           int block_size,
                           const pixel_value* range_plane, int range_stride,
-                          const pixel_value* down_plane,  int down_stride,
-                          int image_height);
+                          const std::vector<DomainPool> &domains,
+                          const std::vector<DomainIndex> &index);
 
     /// Quality threshold for subdivision: if mean squared error >= `quality_`, subdivide further (lower values mean higher required fidelity).
     int quality_;
+    /// Worker threads used by encode() (0 = one per hardware thread).
+    unsigned threads_;
+    /// Domains compared with each range block.
+    DomainSearch search_;
+    /// Index points fitted per range block by DomainSearch::Nearest.
+    unsigned nearest_;
 };
 
 #endif // ARCHIVATOR_QTE_HPP
@@ -0,0 +1,70 @@
+#ifndef ARCHIVATOR_THREAD_POOL_HPP
+#define ARCHIVATOR_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Fixed-size pool of worker threads executing submitted tasks in FIFO order.
+ *
+ * Used by the codecs to process independent blocks in parallel. Results are handed back through `std::future`, so
+ * callers collect them in submission order and the output does not depend on the number of threads or on scheduling.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Start the worker threads.
+     * @param threads Number of workers; 0 selects `std::thread::hardware_concurrency()` (at least 1).
+     */
+    explicit ThreadPool(unsigned threads = 0);
+
+    /**
+     * @brief Finish the queued tasks and join the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Number of worker threads.
+     */
+    unsigned size() const noexcept { return static_cast<unsigned>(workers_.size()); }
+
+    /**
+     * @brief Queue a task for execution.
+     * @param task Callable without arguments.
+     * @return Future holding the task's result (or the exception it threw).
+     */
+    template <class F>
+    auto submit(F &&task) -> std::future<std::invoke_result_t<F>> {
+        using Result = std::invoke_result_t<F>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace([packaged] { (*packaged)(); });
+        }
+        ready_.notify_one();
+        return result;
+    }
+
+private:
+    /// Body of every worker: pop and run tasks until the pool is stopped and the queue is empty.
+    void worker_loop();
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stop_ = false;
+};
+
+#endif // ARCHIVATOR_THREAD_POOL_HPP
@@ -0,0 +1,111 @@
+#ifndef ARCHIVATOR_RANS_HPP
+#define ARCHIVATOR_RANS_HPP
+
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+#include <controller/IController.hpp>
+#include <dto/BitWriter.hpp>
+#include <dto/BitReader.hpp>
+
+/**
+ * @brief Order-0 rANS entropy coder for general file compression.
+ *
+ * An alternative to HuffmanAlgo that codes every byte with a fractional number of bits. The input is split into
+ * kBlockBytes blocks, each with its own normalized frequency table, so the model follows changes in the byte
+ * distribution along the file. Four rANS states with 32-bit precision are interleaved so that consecutive symbols
+ * form independent dependency chains during decoding.
+ *
+ * The output format is a custom ".rans" file: `kRansMagic`, the number of encoded bytes (uint64), the block size
+ * (uint32), then for every block its payload size (uint32) followed by the payload (see encode_block()).
+ */
+class RansAlgo final : public IController {
+    /// Leading bytes of a .rans file.
+    static constexpr std::array<uint8_t, 8> kRansMagic = {0x89, 'R', 'N', 'S', '\r', '\n', 0x1A, 0x01};
+    /// Number of input bytes per block (one frequency table per block).
+    static constexpr uint32_t kBlockBytes = 1 << 19;
+    /// Frequencies of a block are normalized to sum to `1 << kScaleBits`.
+    static constexpr unsigned kScaleBits = 14;
+    /// Lower bound of the normalized state interval; states live in [kStateLow, kStateLow << 16).
+    static constexpr uint32_t kStateLow = 1u << 16;
+    /// Number of interleaved states.
+    static constexpr unsigned kStates = 4;
+
+    /**
+     * @brief Normalized frequency table of one block.
+     */
+    struct SymbolStats {
+        uint32_t freq[256]{}; ///< Normalized frequency (0 = symbol absent).
+        uint32_t cum[257]{};  ///< Cumulative frequency: `cum[s]` is the sum of `freq[0..s)`.
+
+        /**
+         * @brief Scale a byte histogram so that the frequencies sum to `1 << kScaleBits`.
+         * @param counts Byte histogram; every byte with a non-zero count keeps a non-zero frequency.
+         */
+        void normalize(const uint64_t counts[256]);
+
+        /// Recompute @ref cum from @ref freq.
+        void accumulate();
+    };
+
+    /**
+     * @brief Override: Send common info with "RansAlgo" tag.
+     * @param common_information Compression info (ratio, time, sizes).
+     */
+    void send_common_information(const CommonInformation &common_information) override;
+
+    /**
+     * @brief Override: Send error info with "RansAlgo" tag.
+     * @param error Error message string.
+     */
+    void send_error_information(const std::string &error) override;
+
+    /**
+     * @brief Encode one block.
+     * @param data Bytes of the block.
+     * @return Payload: the frequency table (256-bit presence mask, a 4-bit width `w`, then `freq - 1` in `w` bits for
+     *         every present byte, written with a BitWriter and zero padded to a whole byte), the kStates final states (uint32 each),
+     *         then the renormalization words (uint16 each) in the order the decoder consumes them.
+     */
+    static std::vector<uint8_t> encode_block(std::span<const uint8_t> data);
+
+    /**
+     * @brief Decode one block.
+     * @param payload Bytes produced by encode_block().
+     * @param out Output buffer, already sized to the number of bytes in the block.
+     * @throws std::runtime_error if the payload is corrupt.
+     */
+    static void decode_block(std::span<const uint8_t> payload, std::vector<uint8_t> &out);
+
+public:
+    /**
+     * @brief Constructs the rANS algorithm handler.
+     * @param is_text_output If true, send output messages to text stream; if false, to log file.
+     * @param output_file Output log file path (only if not text output).
+     * @param ref_oss Reference to output string stream (for text mode).
+     */
+    explicit RansAlgo(bool is_text_output, const std::string &output_file, std::ostringstream &ref_oss)
+            : IController(is_text_output, output_file, ref_oss) {
+    }
+
+    /**
+     * @brief Compress a file with the rANS coder.
+     * @param input_filename Path to the input file to compress.
+     *
+     * The compressed file is written to "storageEncoded" with extension ".rans". On failure to read the input or write
+     * the output, sends an error and terminates the program. Reports compression ratio and time via `send_common_information`.
+     */
+    void encode(const std::string &input_filename);
+
+    /**
+     * @brief Decompress a ".rans" file.
+     * @param input_filename Path to the ".rans" file to decompress.
+     *
+     * Writes the original content to "storageDecoded/" with the ".rans" extension removed.
+     * @throws std::runtime_error if the file is not a valid .rans file.
+     */
+    void decode(const std::string &input_filename);
+};
+
+#endif // ARCHIVATOR_RANS_HPP
@@ -1,66 +1,158 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <numbers>
+#include <iostream>
+#include <stdexcept>
+#include <dto/InputView.hpp>
 #include <audio/FlacAlgo.hpp>
-void ::FlacAlgo::Lpc::train(const std::vector<int16_t> &input) {
-    int n = static_cast<int>(input.size());
-    coeffs_.resize(kGlobalOrder + 1, 0);
 
-    std::vector<double> r(kGlobalOrder + 1, 0); // Autocorrelation sequence
+#if defined(__unix__) || defined(__APPLE__)
+#define ARCHIVATOR_FLAC_POSIX_READ 1
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+void ::FlacAlgo::Lpc::train(const std::vector<int32_t> &input) {
+    const std::vector<float> windowed = LpcAnalysis::apply_window(input, kLpcWindow);
+    double r[kGlobalOrder + 1]; // Autocorrelation sequence
+    LpcAnalysis::autocorrelation(windowed, kGlobalOrder, r);
 
-    for (int i = 0; i <= kGlobalOrder; ++i) {
-        for (int j = 0; j < n - i; ++j) {
-            r[i] += input[j] * input[j + i];
-        }
-    }
-
-    // We perform the Levinson-Durbin method to find the LPC coefficients
-    std::vector<double> alpha(kGlobalOrder + 1, 0);
-    std::vector<double> kappa(kGlobalOrder + 1, 0);
-    std::vector<double> am1(kGlobalOrder + 1, 0);
-
-
-    am1[0] = 1;
+    // Levinson-Durbin yields the predictor and error energy of every order at once; keep the cheapest order
+    double coeffs[kGlobalOrder * kGlobalOrder];
+    double error[kGlobalOrder + 1];
+    const unsigned top = LpcAnalysis::levinson_durbin(r, kGlobalOrder, coeffs, error);
 
-    am1[0] = 1;
-    alpha[0] = 1.0;
-    coeffs_[0] = alpha[0];
-    double em1 = r[0];
-
-    for (int m = 1; m <= kGlobalOrder; ++m) {
-        double sum = 0;
-        for (int j = 1; j <= m - 1; ++j) {
-            sum += am1[j] * r[m - j];
-        }
-        double km = (r[m] - sum) / em1;
-        kappa[m - 1] = -static_cast<float>(km);
-        alpha[m] = static_cast<float>(km);
-
-        for (int j = 1; j <= m - 1; ++j) {
-            alpha[j] = am1[j] - km * am1[m - j];
+    fixed_ = false;
+    order_ = 0;
+    double best_bits = estimate_bits(error[0], input.size(), 0);
+    for (unsigned m = 1; m <= top; ++m) {
+        const double bits = estimate_bits(error[m], input.size(), m);
+        if (bits < best_bits) {
+            best_bits = bits;
+            order_ = m;
         }
-        double em = (1 - km * km) * em1;
-        for (int s = 0; s <= kGlobalOrder; ++s) {
-            am1[s] = alpha[s];
-        }
-        coeffs_[m] = alpha[m];
-        em1 = em;
     }
-
-    for (int s = 0; s <= kGlobalOrder; ++s) {
-        coeffs_[s] = alpha[s];
+    const double *row = coeffs + static_cast<size_t>(order_ > 0 ? order_ - 1 : 0) * kGlobalOrder;
+    coeffs_.assign(1, 1.0);
+    coeffs_.insert(coeffs_.end(), row, row + order_);
+}
+double FlacAlgo::Lpc::estimate_bits(double error, size_t n, unsigned order) {
+    const double header = kLpcOrderBits + (order > 0 ? kLpcShiftBits + order * kLpcPrecision : 0);
+    if (!(error > 0) || n == 0) {
+        return header;
     }
+    // Rice-coded Laplacian residuals of energy `error` cost about 0.5*log2(error * ln(2)^2 / (2n)) bits each
+    const double per_sample = 0.5 * std::log2(error * 0.5 * std::numbers::ln2 * std::numbers::ln2 / static_cast<double>(n));
+    return header + static_cast<double>(n) * std::max(per_sample, 0.0);
 }
-int16_t FlacAlgo::Lpc::predict(const std::vector<int16_t> &input, size_t index) const {
-    double prediction = coeffs_[0];
-    for (size_t i = 1; i <= kGlobalOrder; ++i) {
-        if (i <= index) {
-            prediction += coeffs_[i] * input[index - i];
-        }
+void FlacAlgo::Lpc::choose_fixed(const std::vector<int32_t> &input) {
+    // sum of |residual| of each polynomial order, in one pass over the block
+    uint64_t total[kFixedMaxOrder + 1] = {};
+    for (size_t j = kFixedMaxOrder; j < input.size(); ++j) {
+        const int64_t e0 = input[j];
+        const int64_t e1 = e0 - input[j - 1];
+        const int64_t e2 = e1 - (input[j - 1] - input[j - 2]);
+        const int64_t e3 = e2 - (input[j - 1] - 2 * input[j - 2] + input[j - 3]);
+        const int64_t e4 = e3 - (input[j - 1] - 3 * input[j - 2] + 3 * input[j - 3] - input[j - 4]);
+        total[0] += static_cast<uint64_t>(std::abs(e0));
+        total[1] += static_cast<uint64_t>(std::abs(e1));
+        total[2] += static_cast<uint64_t>(std::abs(e2));
+        total[3] += static_cast<uint64_t>(std::abs(e3));
+        total[4] += static_cast<uint64_t>(std::abs(e4));
+    }
+    set_fixed(static_cast<unsigned>(std::min_element(std::begin(total), std::end(total)) - std::begin(total)));
+}
+void FlacAlgo::Lpc::set_fixed(unsigned order) {
+    // binomial coefficients of (1 - z^-1)^order, oldest tap first
+    static constexpr int32_t kFixedCoeffs[kFixedMaxOrder + 1][kFixedMaxOrder] = {
+            {}, {1}, {-1, 2}, {1, -3, 3}, {-1, 4, -6, 4}};
+    fixed_ = true;
+    order_ = order;
+    shift_ = 0;
+    coeffs_.clear();
+    reversed_.fill(0);
+    std::copy_n(kFixedCoeffs[order], order, reversed_.begin());
+}
+void FlacAlgo::Lpc::quantize() {
+    constexpr int32_t kMax = (1 << (kLpcPrecision - 1)) - 1;
+    constexpr int32_t kMin = -(1 << (kLpcPrecision - 1));
+    constexpr unsigned kMaxShift = (1u << kLpcShiftBits) - 1;
+    double cmax = 0;
+    for (size_t i = 1; i < coeffs_.size(); ++i) {
+        cmax = std::max(cmax, std::abs(coeffs_[i]));
+    }
+    fixed_ = false;
+    reversed_.fill(0);
+    shift_ = 0;
+    if (!(cmax > 0) || !std::isfinite(cmax)) {
+        return; // silent block: predict zero
+    }
+    // cmax < 2^exponent, so the largest coefficient needs exponent + shift bits plus the sign
+    int exponent = 0;
+    std::frexp(cmax, &exponent);
+    shift_ = static_cast<unsigned>(std::clamp<int>(static_cast<int>(kLpcPrecision) - 1 - exponent, 0, kMaxShift));
+    double error = 0;
+    for (size_t i = 1; i < coeffs_.size(); ++i) {
+        error += std::ldexp(coeffs_[i], static_cast<int>(shift_));
+        const auto q = static_cast<int32_t>(std::clamp<double>(std::lround(error), kMin, kMax));
+        reversed_[order_ - i] = q;
+        error -= q;
     }
-    return prediction;
+}
+void FlacAlgo::Lpc::write(BitWriter &stream) const {
+    stream.put_bit(fixed_);
+    if (fixed_) {
+        stream.put_bits(order_, kFixedOrderBits);
+        return;
+    }
+    stream.put_bits(order_, kLpcOrderBits);
+    if (order_ == 0) return;
+    stream.put_bits(shift_, kLpcShiftBits);
+    for (size_t i = order_; i-- > 0;) {
+        stream.put_bits(static_cast<uint32_t>(reversed_[i]), kLpcPrecision);
+    }
+}
+void FlacAlgo::Lpc::read(BitReader &stream) {
+    if (stream.get_bit()) {
+        const auto order = static_cast<unsigned>(stream.get_bits(kFixedOrderBits));
+        if (order > kFixedMaxOrder) throw std::runtime_error("corrupt FLAC block");
+        set_fixed(order);
+        return;
+    }
+    fixed_ = false;
+    reversed_.fill(0);
+    shift_ = 0;
+    order_ = static_cast<unsigned>(stream.get_bits(kLpcOrderBits));
+    if (order_ > kGlobalOrder) throw std::runtime_error("corrupt FLAC block");
+    if (order_ == 0) return;
+    shift_ = static_cast<unsigned>(stream.get_bits(kLpcShiftBits));
+    for (size_t i = order_; i-- > 0;) {
+        // sign-extend the kLpcPrecision-bit field
+        const auto bits = static_cast<uint32_t>(stream.get_bits(kLpcPrecision)) << (32 - kLpcPrecision);
+        reversed_[i] = static_cast<int32_t>(bits) >> (32 - kLpcPrecision);
+    }
+}
+int32_t FlacAlgo::Lpc::predict(const std::vector<int32_t> &input, size_t index) const {
+    if (index >= order_) {
+        return predict_full(input.data() + index - order_);
+    }
+    int64_t sum = 0;
+    for (size_t i = 1; i <= index; ++i) {
+        sum += static_cast<int64_t>(reversed_[order_ - i]) * input[index - i];
+    }
+    return clamp_prediction(sum >> shift_);
 }
 
 // Linear predictive coding
 void ::FlacAlgo::Lpc::clear() {
     coeffs_.clear();
+    reversed_.fill(0);
+    shift_ = 0;
+    order_ = 0;
+    fixed_ = false;
 }
 void FlacAlgo::send_common_information(const CommonInformation &common_information)  {
     send_message("FlacAlgo{ ");
@@ -72,112 +164,115 @@ void FlacAlgo::send_error_information(const std::string &error)  {
 }
 void FlacAlgo::send_global_params() const  {
     std::ostringstream oss;
-    oss << "FlacAlgo: kGlobalSizeBlocks: " <<kGlobalSizeBlocks  << ", kGlobalOrder: " << kGlobalOrder << ", k: "
-            << kGlobalK << '\n';
+    oss << "FlacAlgo: kGlobalSizeBlocks: " <<kGlobalSizeBlocks  << ", kGlobalOrder (max): " << kGlobalOrder << ", coefficients: "
+            << kLpcPrecision << " bits, shift 0.." << (1u << kLpcShiftBits) - 1 << ", k: adaptive per " << kRicePartitionSamples
+            << " residuals\n";
     std::string str = oss.str();
     send_message(str);
 }
-void FlacAlgo::rice_encode(BitStream &stream, int num)  {
-    if (num < 0) {
-        stream.add_bit(true);
-        num *= -1;
-    } else {
-        stream.add_bit(false);
-    }
-    int q = num >> kGlobalK;
-    for (int i = 0; i < q; ++i) {
-        stream.add_bit(true);
-    }
-    stream.add_bit(false);
-    for (int i = 0; i < kGlobalK; ++i) {
-        stream.add_bit((num >> (kGlobalK - 1 - i)) & 1);
+void FlacAlgo::encode_residuals(BitWriter &stream, std::span<const int32_t> residuals, unsigned escape_bits)  {
+    const std::vector<uint32_t> folded = RiceCoder::fold(residuals);
+    const std::span<const uint32_t> all(folded);
+    for (size_t first = 0; first < all.size(); first += kRicePartitionSamples) {
+        const auto partition = all.subspan(first, std::min<size_t>(kRicePartitionSamples, all.size() - first));
+        const unsigned k = RiceCoder::best_parameter(partition, escape_bits + 1);
+        stream.put_bits(k, kRiceParameterBits);
+        RiceCoder::encode_block(stream, partition, k, escape_bits + 1);
     }
 }
-int FlacAlgo::rice_decode(BitStream &stream)  {
-    int sgn = 1;
-    if (stream.get_bit()) {
-        sgn = -1;
-    }
-    int q = 0;
-    while (stream.get_bit() == 1) {
-        q++;
-    }
-    int num = q << kGlobalK;
-    for (int j = 0; j < kGlobalK; ++j) {
-        if (stream.get_bit()) {
-            num |= (1 << (kGlobalK - 1 - j));
+std::vector<int32_t> FlacAlgo::read_candidate(std::span<const uint8_t> pcm, unsigned channels, unsigned bits_per_sample, unsigned candidate)  {
+    const unsigned sample_bytes = bits_per_sample / 8;
+    const size_t frame_bytes = size_t{channels} * sample_bytes;
+    const size_t frames = pcm.size() / frame_bytes;
+    auto sample = [&pcm, frame_bytes, sample_bytes, bits_per_sample](size_t frame, unsigned channel) {
+        return WavReader::decode_sample(pcm.data() + frame * frame_bytes + channel * sample_bytes, bits_per_sample);
+    };
+    std::vector<int32_t> samples(frames);
+    if (candidate < channels) {
+        for (size_t j = 0; j < frames; ++j) {
+            samples[j] = sample(j, candidate);
+        }
+    } else if (candidate == 2) {
+        for (size_t j = 0; j < frames; ++j) {
+            samples[j] = sample(j, 0) - sample(j, 1);
+        }
+    } else {
+        for (size_t j = 0; j < frames; ++j) {
+            samples[j] = (sample(j, 0) + sample(j, 1)) >> 1;
         }
     }
-    return sgn * num;
+    return samples;
 }
-std::vector<uint8_t> FlacAlgo::encode_vector(const std::vector<int16_t> &vec)  {
-    BitStream stream;
-    for (int16_t num: vec) {
-        rice_encode(stream, num);
+std::vector<uint8_t> FlacAlgo::encode_block(std::span<const uint8_t> pcm, unsigned channels, unsigned bits_per_sample, bool fast)  {
+    std::vector<std::vector<uint8_t>> subframes;
+    for (unsigned c = 0; c < candidate_count(channels); ++c) {
+        // the side signal of a stereo pair needs one bit more than the input
+        const unsigned bits = bits_per_sample + (channels == 2 && c == 2 ? 1 : 0);
+        subframes.push_back(encode_subframe(read_candidate(pcm, channels, bits_per_sample, c), bits, fast));
     }
-    return stream.data;
+    return assemble_block(channels, subframes);
 }
-std::vector<int16_t> FlacAlgo::decode_vector(std::vector<uint8_t> data)  {
-    BitStream stream(std::move(data));
-    std::vector<int16_t> decoded;
-    while (stream.bit_index < stream.data.size() * 8 - 7) {
-        decoded.push_back(rice_decode(stream));
+std::vector<uint8_t> FlacAlgo::encode_subframe(const std::vector<int32_t> &samples, unsigned bits, bool fast)  {
+    Lpc fixed;
+    fixed.set_sample_bits(bits);
+    fixed.choose_fixed(samples);
+    if (fast) {
+        return encode_subframe(samples, fixed);
     }
-    return decoded;
+    Lpc lpc;
+    lpc.set_sample_bits(bits);
+    lpc.train(samples);
+    lpc.quantize();
+    // the fixed predictors win on some signals (pure tones, steps): keep whichever subframe is shorter
+    std::vector<uint8_t> bytes = encode_subframe(samples, lpc);
+    std::vector<uint8_t> fixed_bytes = encode_subframe(samples, fixed);
+    return fixed_bytes.size() < bytes.size() ? fixed_bytes : bytes;
 }
-bool FlacAlgo::read_wav_header(const std::string &filename, WavHeader &header)  {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        send_error_information("Failed to open file: " + filename + '\n');
-        return false;
-    }
-
-    file.read(reinterpret_cast<char *>(&header), sizeof(WavHeader));
-
-    if (std::string(header.chunk_id, 4) != "RIFF" || std::string(header.format, 4) != "WAVE" ||
-        header.audio_format != 1 || header.num_channels != 1) {
-        send_error_information("Invalid WAV file format.\n");
-        file.close();
-        return false;
-    }
+std::vector<uint8_t> FlacAlgo::encode_subframe(const std::vector<int32_t> &samples, const Lpc &lpc)  {
+    BitWriter stream(samples.size() * sizeof(int16_t));
+    lpc.write(stream);
 
-    if (std::string(header.subchunk2_id) != "data") {
-        file.seekg(header.subchunk2_size, std::ios::cur);
-        file.read(reinterpret_cast<char *>(&(header.subchunk2_id)), sizeof(header.subchunk2_id));
-        file.read(reinterpret_cast<char *>(&(header.subchunk2_size)), sizeof(int32_t));
+    std::vector<int32_t> residuals(samples.size());
+    for (size_t j = 0; j < samples.size(); ++j) {
+        residuals[j] = samples[j] - lpc.predict(samples, j);
     }
-    file.close();
-    return true;
+    encode_residuals(stream, residuals, lpc.sample_bits());
+    return stream.finish();
 }
-std::vector<int16_t> FlacAlgo::read_wav_data(const std::string &filename, const WavHeader &header, size_t start_index)  {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        send_error_information("Failed to open file: " + filename + '\n');
-        return {};
+std::vector<uint8_t> FlacAlgo::assemble_block(unsigned channels, const std::vector<std::vector<uint8_t>> &candidates)  {
+    auto mode = Decorrelation::Independent;
+    std::vector<const std::vector<uint8_t> *> chosen;
+    for (const auto &candidate: candidates) {
+        chosen.push_back(&candidate);
     }
-
-    file.seekg(sizeof(WavHeader), std::ios::beg);
-    file.seekg(start_index * sizeof(int16_t), std::ios::cur);
-
-
-    if (header.subchunk2_size % sizeof(int16_t) != 0) {
-        send_error_information("Invalid data size in WAV file.\n");
-        return {};
+    if (channels == 2) {
+        // candidates are left, right, side, mid
+        const size_t left = candidates[0].size();
+        const size_t right = candidates[1].size();
+        const size_t side = candidates[2].size();
+        const size_t mid = candidates[3].size();
+        const size_t costs[] = {left + right, left + side, side + right, mid + side};
+        const auto best = static_cast<size_t>(std::min_element(std::begin(costs), std::end(costs)) - std::begin(costs));
+        constexpr size_t kPairs[4][2] = {{0, 1}, {0, 2}, {2, 1}, {3, 2}};
+        mode = static_cast<Decorrelation>(best);
+        chosen = {&candidates[kPairs[best][0]], &candidates[kPairs[best][1]]};
     }
-
-    std::vector<int16_t> audio_data;
-    if (header.subchunk2_size / sizeof(int16_t) >= start_index + kGlobalSizeBlocks) {
-        audio_data.resize(kGlobalSizeBlocks);
-        file.read(reinterpret_cast<char *>(audio_data.data()), kGlobalSizeBlocks * sizeof(int16_t));
-    } else {
-        audio_data.resize(header.subchunk2_size / sizeof(int16_t) - start_index);
-        file.read(reinterpret_cast<char *>(audio_data.data()), header.subchunk2_size - sizeof(int16_t) * start_index);
+    size_t total = 1;
+    for (const auto *subframe: chosen) {
+        total += sizeof(uint32_t) + subframe->size();
     }
-
-    file.close();
-    return audio_data;
+    std::vector<uint8_t> block;
+    block.reserve(total);
+    block.push_back(static_cast<uint8_t>(mode));
+    for (const auto *subframe: chosen) {
+        const auto size = static_cast<uint32_t>(subframe->size());
+        const auto *size_bytes = reinterpret_cast<const uint8_t *>(&size);
+        block.insert(block.end(), size_bytes, size_bytes + sizeof(uint32_t));
+        block.insert(block.end(), subframe->begin(), subframe->end());
+    }
+    return block;
 }
-void FlacAlgo::encode(const std::string &input_filename)  {
+void FlacAlgo::encode(const std::string &input_filename, unsigned threads, bool fast)  {
     auto start = std::chrono::high_resolution_clock::now();
     int size_input = static_cast<int>(get_filesize( input_filename));
     size_t last_slash_pos = input_filename.find_last_of('/');
@@ -185,43 +280,58 @@ void FlacAlgo::encode(const std::string &input_filename)  {
             last_slash_pos != std::string::npos ? input_filename.substr(last_slash_pos + 1) : input_filename;
     size_t pos = tmp_input_filename.rfind('.');
     std::string output_filename ="storageEncoded/"+ tmp_input_filename.substr(0, pos) + ".flac";// путь сохранения
-    WavHeader header{};
-    if (!read_wav_header(input_filename, header)) {
-        send_error_information("Failed to read WAV file.\n");
+    WavReader reader(input_filename);
+    if (!reader.is_open()) {
+        send_error_information("Failed to read WAV file: " + reader.error() + '\n');
         exit(-1);
     }
-    BitStream stream;
-    size_t size = 0;
-    for (size_t i = 0; header.subchunk2_size / sizeof(int16_t) > i * kGlobalSizeBlocks; ++i) {
-        std::vector<int16_t> pcm_data = read_wav_data( input_filename, header, kGlobalSizeBlocks * i);
-        lpc_.train(pcm_data);
-
-        for (size_t j = 0; j < kGlobalOrder + 1; ++j) {
-            int16_t arr[4] = {};
-            std::memcpy(arr,&lpc_.coeffs_[j], sizeof(double));
-            rice_encode(stream, arr[0]);
-            rice_encode(stream, arr[1]);
-            rice_encode(stream, arr[2]);
-            rice_encode(stream, arr[3]);
-        }
-
-        for (size_t j = 0; j < pcm_data.size(); ++j) {
-            rice_encode(stream, pcm_data[j] - lpc_.predict(pcm_data, j));
-        }
-        lpc_.clear();
-    }
     std::ofstream output_file(output_filename, std::ios::binary);
-    if (output_file.is_open()) {
-        output_file.write(reinterpret_cast<const char *>(&header), sizeof(WavHeader));
-        size = stream.data.size();
-        output_file.write(reinterpret_cast<const char *>(&size), sizeof(size_t));
-        output_file.write(reinterpret_cast<const char *>(stream.data.data()), size);
-        output_file.close();
-        send_message("FLAC data saved to: " + output_filename + '\n');
-    } else {
+    if (!output_file.is_open()) {
         send_error_information("Failed to write FLAC file.\n");
         exit(-1);
     }
+    const uint32_t block_frames = kGlobalSizeBlocks;
+    const uint16_t channels = reader.channels();
+    const uint16_t bits_per_sample = reader.bits_per_sample();
+    const uint64_t frames = reader.frames();
+    const size_t block_count = (frames + block_frames - 1) / block_frames;
+    BlockWriter writer(output_file, channels, bits_per_sample, block_frames, reader.prefix());
+
+    // one task per channel (and per stereo side/mid signal) of a block, so even a single block keeps several workers busy
+    ThreadPool pool(threads);
+    const unsigned candidates = candidate_count(channels);
+    const size_t wave = std::max<size_t>(1, 2 * static_cast<size_t>(pool.size()) / candidates);
+    reader.prefetch(0, wave * block_frames);
+    std::vector<std::vector<std::future<std::vector<uint8_t>>>> pending;
+    for (size_t first = 0; first < block_count; first += wave) {
+        const size_t last = std::min<size_t>(first + wave, block_count);
+        // read the next wave ahead while this one is coded
+        reader.prefetch(last * block_frames, wave * block_frames);
+        pending.clear();
+        for (size_t b = first; b < last; ++b) {
+            const size_t first_frame = b * block_frames;
+            const auto pcm = reader.pcm(first_frame, std::min<size_t>(block_frames, frames - first_frame));
+            auto &block_tasks = pending.emplace_back();
+            for (unsigned c = 0; c < candidates; ++c) {
+                // the side signal of a stereo pair needs one bit more than the input
+                const unsigned bits = bits_per_sample + (channels == 2 && c == 2 ? 1 : 0);
+                block_tasks.push_back(pool.submit([pcm, channels, bits_per_sample, c, bits, fast] {
+                    return encode_subframe(read_candidate(pcm, channels, bits_per_sample, c), bits, fast);
+                }));
+            }
+        }
+        for (size_t b = first; b < last; ++b) {
+            std::vector<std::vector<uint8_t>> subframes;
+            for (auto &task: pending[b - first]) {
+                subframes.push_back(task.get());
+            }
+            writer.add(assemble_block(channels, subframes), std::min<size_t>(block_frames, frames - b * block_frames));
+        }
+    }
+    writer.finish(reader.trailer());
+    output_file.close();
+    send_message("FLAC data saved to: " + output_filename + '\n');
+
     std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
     int size_output = static_cast<int>(get_filesize(output_filename));
     double ratio = static_cast<double>(size_output) / size_input;
@@ -232,57 +342,417 @@ void FlacAlgo::encode(const std::string &input_filename)  {
     send_global_params();
 }
 
-void FlacAlgo::decode(const std::string &input_filename)  {
+FlacAlgo::BlockWriter::BlockWriter(std::ostream &output, uint16_t channels, uint16_t bits_per_sample, uint32_t block_frames,
+                                   std::span<const uint8_t> prefix) : output_(output) {
+    const auto prefix_bytes = static_cast<uint32_t>(prefix.size());
+    output_.write(reinterpret_cast<const char *>(kFlacMagic.data()), kFlacMagic.size());
+    output_.write(reinterpret_cast<const char *>(&channels), sizeof(uint16_t));
+    output_.write(reinterpret_cast<const char *>(&bits_per_sample), sizeof(uint16_t));
+    output_.write(reinterpret_cast<const char *>(&block_frames), sizeof(uint32_t));
+    // block count, frame count and index offset are known at the end: reserve them, finish() fills them in
+    totals_pos_ = output_.tellp();
+    const char totals[sizeof(uint32_t) + 2 * sizeof(uint64_t)] = {};
+    output_.write(totals, sizeof(totals));
+    output_.write(reinterpret_cast<const char *>(&prefix_bytes), sizeof(uint32_t));
+    output_.write(reinterpret_cast<const char *>(prefix.data()), prefix_bytes);
+}
+void FlacAlgo::BlockWriter::add(std::span<const uint8_t> block, size_t frames) {
+    output_.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(block.size()));
+    const SeekPoint &last = seek_.back();
+    seek_.push_back({last.first_frame + frames, last.offset + block.size()});
+}
+void FlacAlgo::BlockWriter::finish(std::span<const uint8_t> trailer) {
+    const auto trailer_bytes = static_cast<uint32_t>(trailer.size());
+    output_.write(reinterpret_cast<const char *>(&trailer_bytes), sizeof(uint32_t));
+    output_.write(reinterpret_cast<const char *>(trailer.data()), trailer_bytes);
+    output_.write(reinterpret_cast<const char *>(seek_.data()), static_cast<std::streamsize>(seek_.size() * sizeof(SeekPoint)));
+    const auto end = output_.tellp();
+
+    const auto block_count = static_cast<uint32_t>(seek_.size() - 1);
+    const uint64_t frames = seek_.back().first_frame;
+    const uint64_t index_offset = seek_.back().offset;
+    output_.seekp(totals_pos_);
+    output_.write(reinterpret_cast<const char *>(&block_count), sizeof(uint32_t));
+    output_.write(reinterpret_cast<const char *>(&frames), sizeof(uint64_t));
+    output_.write(reinterpret_cast<const char *>(&index_offset), sizeof(uint64_t));
+    output_.seekp(end);
+}
+FlacAlgo::StreamEncoder::StreamEncoder(std::ostream &output, uint32_t block_frames, bool fast)
+    : output_(output), block_frames_(block_frames), fast_(fast) {
+    if (block_frames_ == 0) {
+        throw std::invalid_argument("block size must be positive");
+    }
+}
+void FlacAlgo::StreamEncoder::push(std::span<const uint8_t> bytes) {
+    if (writer_) {
+        push_samples(bytes);
+        return;
+    }
+    pending_.insert(pending_.end(), bytes.begin(), bytes.end());
+    const auto status = WavReader::parse_header(pending_, format_, error_);
+    if (status == WavReader::HeaderStatus::Invalid) {
+        throw std::runtime_error(error_);
+    }
+    if (status == WavReader::HeaderStatus::Incomplete) return;
+
+    // capture tools that cannot seek back leave the size of the data chunk at 0 or 0xFFFFFFFF
+    const bool open_ended = format_.data_bytes == 0 || format_.data_bytes == UINT32_MAX;
+    samples_left_ = open_ended ? UINT64_MAX : format_.data_bytes / format_.block_align * uint64_t{format_.block_align};
+    writer_.emplace(output_, format_.channels, format_.bits_per_sample, block_frames_,
+                    std::span<const uint8_t>(pending_).first(format_.data_offset));
+    output_.flush();
+    std::vector<uint8_t> head;
+    head.swap(pending_);
+    pending_.reserve(size_t{block_frames_} * format_.block_align);
+    push_samples(std::span<const uint8_t>(head).subspan(format_.data_offset));
+}
+void FlacAlgo::StreamEncoder::push_samples(std::span<const uint8_t> bytes) {
+    const size_t block_bytes = size_t{block_frames_} * format_.block_align;
+    const auto samples = bytes.first(static_cast<size_t>(std::min<uint64_t>(bytes.size(), samples_left_)));
+    samples_left_ -= samples.size();
+    trailer_.insert(trailer_.end(), bytes.begin() + static_cast<std::ptrdiff_t>(samples.size()), bytes.end());
+    for (size_t offset = 0; offset < samples.size();) {
+        const size_t take = std::min(samples.size() - offset, block_bytes - pending_.size());
+        pending_.insert(pending_.end(), samples.begin() + static_cast<std::ptrdiff_t>(offset),
+                        samples.begin() + static_cast<std::ptrdiff_t>(offset + take));
+        offset += take;
+        if (pending_.size() == block_bytes) {
+            writer_->add(encode_block(pending_, format_.channels, format_.bits_per_sample, fast_), block_frames_);
+            output_.flush();
+            pending_.clear();
+        }
+    }
+}
+void FlacAlgo::StreamEncoder::finish() {
+    if (!writer_) {
+        throw std::runtime_error(error_.empty() ? "Invalid WAV file format." : error_);
+    }
+    // a partial frame at the end is kept verbatim, ahead of whatever followed the data chunk
+    const size_t frames = pending_.size() / format_.block_align;
+    const auto samples = std::span<const uint8_t>(pending_).first(frames * format_.block_align);
+    if (frames > 0) {
+        writer_->add(encode_block(samples, format_.channels, format_.bits_per_sample, fast_), frames);
+    }
+    trailer_.insert(trailer_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(samples.size()), pending_.end());
+    writer_->finish(trailer_);
+    output_.flush();
+    pending_.clear();
+    trailer_.clear();
+}
+void FlacAlgo::encode_stream(const std::string &input_filename, uint32_t block_frames, bool fast)  {
     auto start = std::chrono::high_resolution_clock::now();
-    int size_input = static_cast<int>(get_filesize( input_filename));
+    const bool from_stdin = input_filename == "-";
     size_t last_slash_pos = input_filename.find_last_of('/');
     std::string tmp_input_filename =
             last_slash_pos != std::string::npos ? input_filename.substr(last_slash_pos + 1) : input_filename;
     size_t pos = tmp_input_filename.rfind('.');
-    std::string output_filename ="storageEncoded/"+ tmp_input_filename.substr(0, pos) + ".flac";// путь сохранения
-    WavHeader header{};
-    if (!read_wav_header(input_filename, header)) {
-        send_error_information("Failed to read WAV file.\n");
+    std::string output_filename = "storageEncoded/" + (from_stdin ? std::string("stdin") : tmp_input_filename.substr(0, pos)) + ".flac";
+
+#ifdef ARCHIVATOR_FLAC_POSIX_READ
+    // read() returns whatever the pipe holds, so a block is coded as soon as its last frame arrives
+    const int fd = from_stdin ? STDIN_FILENO : ::open(input_filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        send_error_information("Failed to open file: " + input_filename + '\n');
         exit(-1);
     }
-    BitStream stream;
-    size_t size = 0;
-    for (size_t i = 0; header.subchunk2_size / sizeof(int16_t) > i * kGlobalSizeBlocks; ++i) {
-        std::vector<int16_t> pcm_data = read_wav_data( input_filename, header, kGlobalSizeBlocks * i);
-        lpc_.train(pcm_data);
+    auto read_some = [fd](uint8_t *buffer, size_t size) -> ptrdiff_t {
+        while (true) {
+            const ssize_t got = ::read(fd, buffer, size);
+            if (got >= 0 || errno != EINTR) return got;
+        }
+    };
+#else
+    std::ifstream file;
+    if (!from_stdin) file.open(input_filename, std::ios::binary);
+    std::istream &input = from_stdin ? std::cin : file;
+    if (!input) {
+        send_error_information("Failed to open file: " + input_filename + '\n');
+        exit(-1);
+    }
+    auto read_some = [&input](uint8_t *buffer, size_t size) -> ptrdiff_t {
+        input.read(reinterpret_cast<char *>(buffer), static_cast<std::streamsize>(size));
+        return input.bad() ? -1 : static_cast<ptrdiff_t>(input.gcount());
+    };
+#endif
 
-        for (size_t j = 0; j < kGlobalOrder + 1; ++j) {
-            int16_t arr[4] = {};
-            std::memcpy(arr,&lpc_.coeffs_[j], sizeof(double));
-            rice_encode(stream, arr[0]);
-            rice_encode(stream, arr[1]);
-            rice_encode(stream, arr[2]);
-            rice_encode(stream, arr[3]);
+    std::ofstream output_file(output_filename, std::ios::binary);
+    if (!output_file.is_open()) {
+        send_error_information("Failed to write FLAC file.\n");
+        exit(-1);
+    }
+    constexpr size_t kReadBytes = 64 * 1024;
+    std::vector<uint8_t> buffer(kReadBytes);
+    size_t size_input = 0;
+    try {
+        StreamEncoder encoder(output_file, block_frames, fast);
+        while (true) {
+            const ptrdiff_t got = read_some(buffer.data(), buffer.size());
+            if (got < 0) {
+                throw std::runtime_error("Failed to read " + input_filename);
+            }
+            if (got == 0) break;
+            size_input += static_cast<size_t>(got);
+            encoder.push(std::span<const uint8_t>(buffer).first(static_cast<size_t>(got)));
         }
+        encoder.finish();
+    } catch (const std::exception &e) {
+        send_error_information("Failed to encode WAV stream: " + std::string(e.what()) + '\n');
+        exit(-1);
+    }
+#ifdef ARCHIVATOR_FLAC_POSIX_READ
+    if (!from_stdin) ::close(fd);
+#endif
+    output_file.close();
+    send_message("FLAC data saved to: " + output_filename + '\n');
+
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    const auto size_output = static_cast<size_t>(get_filesize(output_filename));
+    double ratio = static_cast<double>(size_output) / static_cast<double>(size_input);
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    auto info = CommonInformation(ratio, static_cast<size_t>(duration.count()), size_input, size_output);
+    send_common_information(info);
+}
+
+std::vector<int32_t> FlacAlgo::decode_subframe(std::span<const uint8_t> subframe, size_t count, unsigned bits)  {
+    BitReader stream(subframe.data(), subframe.size());
+    Lpc lpc;
+    lpc.set_sample_bits(bits);
+    lpc.read(stream);
 
-        for (size_t j = 0; j < pcm_data.size(); ++j) {
-            rice_encode(stream, pcm_data[j] - lpc_.predict(pcm_data, j));
+    std::vector<int32_t> residuals(count);
+    decode_residuals(stream, residuals, bits);
+    if (stream.bits_consumed() > stream.bits_total()) {
+        throw std::runtime_error("corrupt FLAC block");
+    }
+
+    // synthesis filter: integer arithmetic, so the prediction matches the encoder's exactly
+    std::vector<int32_t> samples(count);
+    const size_t warm_up = std::min<size_t>(lpc.order_, count);
+    for (size_t j = 0; j < warm_up; ++j) {
+        samples[j] = residuals[j] + lpc.predict(samples, j);
+    }
+    for (size_t j = warm_up; j < count; ++j) {
+        samples[j] = residuals[j] + lpc.predict_full(samples.data() + j - lpc.order_);
+    }
+    return samples;
+}
+void FlacAlgo::decode_residuals(BitReader &stream, std::span<int32_t> out, unsigned escape_bits)  {
+    for (size_t first = 0; first < out.size(); first += kRicePartitionSamples) {
+        const auto partition = out.subspan(first, std::min<size_t>(kRicePartitionSamples, out.size() - first));
+        const auto k = static_cast<unsigned>(stream.get_bits(kRiceParameterBits));
+        RiceCoder::decode_block(stream, partition, k, escape_bits + 1);
+    }
+}
+std::vector<std::vector<int32_t>> FlacAlgo::decode_block_channels(std::span<const uint8_t> block, size_t frames, unsigned channels, unsigned bits_per_sample)  {
+    if (block.empty() || block[0] > static_cast<uint8_t>(Decorrelation::MidSide) ||
+        (channels != 2 && block[0] != static_cast<uint8_t>(Decorrelation::Independent))) {
+        throw std::runtime_error("corrupt FLAC block");
+    }
+    const auto mode = static_cast<Decorrelation>(block[0]);
+    std::vector<std::vector<int32_t>> decoded(channels);
+    size_t offset = 1;
+    for (unsigned c = 0; c < channels; ++c) {
+        uint32_t size = 0;
+        if (block.size() - offset < sizeof(uint32_t)) throw std::runtime_error("corrupt FLAC block");
+        std::memcpy(&size, block.data() + offset, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+        if (block.size() - offset < size) throw std::runtime_error("corrupt FLAC block");
+        const bool side = (c == 0 && mode == Decorrelation::RightSide) ||
+                          (c == 1 && (mode == Decorrelation::LeftSide || mode == Decorrelation::MidSide));
+        decoded[c] = decode_subframe(block.subspan(offset, size), frames, bits_per_sample + (side ? 1 : 0));
+        offset += size;
+    }
+
+    // undo the stereo decorrelation in place: afterwards decoded[0] is left and decoded[1] is right
+    if (mode != Decorrelation::Independent) {
+        std::vector<int32_t> &first = decoded[0];
+        std::vector<int32_t> &second = decoded[1];
+        for (size_t j = 0; j < frames; ++j) {
+            switch (mode) {
+                case Decorrelation::LeftSide: // left, side
+                    second[j] = first[j] - second[j];
+                    break;
+                case Decorrelation::RightSide: // side, right
+                    first[j] = first[j] + second[j];
+                    break;
+                default: { // mid, side
+                    const int32_t side = second[j];
+                    const int32_t sum = static_cast<int32_t>(static_cast<uint32_t>(first[j]) << 1) | (side & 1);
+                    first[j] = (sum + side) >> 1;
+                    second[j] = (sum - side) >> 1;
+                    break;
+                }
+            }
         }
-        lpc_.clear();
     }
+    return decoded;
+}
+std::vector<uint8_t> FlacAlgo::decode_block(std::span<const uint8_t> block, size_t frames, unsigned channels, unsigned bits_per_sample)  {
+    const std::vector<std::vector<int32_t>> decoded = decode_block_channels(block, frames, channels, bits_per_sample);
+    const unsigned sample_bytes = bits_per_sample / 8;
+    std::vector<uint8_t> pcm(frames * channels * sample_bytes);
+    uint8_t *p = pcm.data();
+    for (size_t j = 0; j < frames; ++j) {
+        for (unsigned c = 0; c < channels; ++c) {
+            const auto sample = static_cast<uint32_t>(decoded[c][j]);
+            for (unsigned i = 0; i < sample_bytes; ++i) {
+                *p++ = static_cast<uint8_t>(sample >> (8 * i));
+            }
+        }
+    }
+    return pcm;
+}
+bool FlacAlgo::check_format(std::span<const uint8_t> data, const std::string &input_filename)  {
+    if (data.size() < kFlacMagic.size() || !std::equal(kFlacMagic.begin(), kFlacMagic.end() - 1, data.begin())) {
+        send_error_information("Not a FLAC file of a supported layout: " + input_filename + '\n');
+        return false;
+    }
+    if (data[kFlacMagic.size() - 1] != kFlacFormatVersion) {
+        send_error_information("Unsupported FLAC format version " + std::to_string(data[kFlacMagic.size() - 1]) +
+                               " (expected " + std::to_string(kFlacFormatVersion) + ")\n");
+        return false;
+    }
+    return true;
+}
+FlacAlgo::FlacStream FlacAlgo::read_stream(std::span<const uint8_t> data)  {
+    size_t offset = kFlacMagic.size();
+    auto take = [&data, &offset](void *out, size_t bytes) {
+        if (data.size() - offset < bytes) throw std::runtime_error("corrupt FLAC header");
+        std::memcpy(out, data.data() + offset, bytes);
+        offset += bytes;
+    };
+    auto take_span = [&data, &offset](size_t bytes) {
+        if (data.size() - offset < bytes) throw std::runtime_error("corrupt FLAC header");
+        const auto span = data.subspan(offset, bytes);
+        offset += bytes;
+        return span;
+    };
+    FlacStream stream;
+    uint32_t block_count = 0;
+    uint64_t index_offset = 0;
+    uint32_t prefix_bytes = 0;
+    uint32_t trailer_bytes = 0;
+    take(&stream.channels, sizeof(stream.channels));
+    take(&stream.bits_per_sample, sizeof(stream.bits_per_sample));
+    take(&stream.block_frames, sizeof(stream.block_frames));
+    take(&block_count, sizeof(block_count));
+    take(&stream.frames, sizeof(stream.frames));
+    take(&index_offset, sizeof(index_offset));
+    take(&prefix_bytes, sizeof(prefix_bytes));
+    stream.prefix = take_span(prefix_bytes);
+    if (stream.channels == 0 || (stream.bits_per_sample != 16 && stream.bits_per_sample != 24) ||
+        stream.block_frames == 0 || data.size() - offset < index_offset) {
+        throw std::runtime_error("corrupt FLAC header");
+    }
+    // the index follows the blocks: WAV trailer, then the seek table
+    stream.blocks = take_span(static_cast<size_t>(index_offset));
+    take(&trailer_bytes, sizeof(trailer_bytes));
+    stream.trailer = take_span(trailer_bytes);
+    if ((data.size() - offset) / sizeof(SeekPoint) <= block_count) {
+        throw std::runtime_error("corrupt FLAC header");
+    }
+    stream.seek.resize(block_count + 1);
+    take(stream.seek.data(), stream.seek.size() * sizeof(SeekPoint));
+    // points must start at zero, end at the totals and grow by at most block_frames frames per block
+    if (stream.seek.front().first_frame != 0 || stream.seek.front().offset != 0 ||
+        stream.seek.back().first_frame != stream.frames || stream.seek.back().offset != index_offset) {
+        throw std::runtime_error("corrupt FLAC header");
+    }
+    for (size_t b = 0; b < block_count; ++b) {
+        const SeekPoint &point = stream.seek[b];
+        const SeekPoint &next = stream.seek[b + 1];
+        if (next.first_frame <= point.first_frame || next.first_frame - point.first_frame > stream.block_frames ||
+            next.offset < point.offset) {
+            throw std::runtime_error("corrupt FLAC header");
+        }
+    }
+    return stream;
+}
+void FlacAlgo::decode(const std::string &input_filename, unsigned threads)  {
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t last_slash_pos = input_filename.find_last_of('/');
+    std::string tmp_input_filename =
+            last_slash_pos != std::string::npos ? input_filename.substr(last_slash_pos + 1) : input_filename;
+    size_t pos = tmp_input_filename.rfind('.');
+    std::string output_filename ="storageDecoded/"+ tmp_input_filename.substr(0, pos) + ".wav";// путь сохранения
+
+    const InputView input(input_filename);
+    if (!input.is_open()) {
+        send_error_information("Failed to open file: " + input_filename + '\n');
+        exit(-1);
+    }
+    if (!check_format(input.bytes(), input_filename)) {
+        exit(-1);
+    }
+    const FlacStream stream = read_stream(input.bytes());
+
     std::ofstream output_file(output_filename, std::ios::binary);
-    if (output_file.is_open()) {
-        output_file.write(reinterpret_cast<const char *>(&header), sizeof(WavHeader));
-        size = stream.data.size();
-        output_file.write(reinterpret_cast<const char *>(&size), sizeof(size_t));
-        output_file.write(reinterpret_cast<const char *>(stream.data.data()), size);
-        output_file.close();
-        send_message("FLAC data saved to: " + output_filename + '\n');
-    } else {
-        send_error_information("Failed to write FLAC file.\n");
+    if (!output_file.is_open()) {
+        send_error_information("Failed to write WAV file.\n");
         exit(-1);
     }
+    output_file.write(reinterpret_cast<const char *>(stream.prefix.data()), static_cast<std::streamsize>(stream.prefix.size()));
+
+    ThreadPool pool(threads);
+    const size_t block_count = stream.seek.size() - 1;
+    const size_t wave = 2 * static_cast<size_t>(pool.size());
+    std::vector<std::future<std::vector<uint8_t>>> pending;
+    for (size_t first = 0; first < block_count; first += wave) {
+        const size_t last = std::min<size_t>(first + wave, block_count);
+        pending.clear();
+        for (size_t b = first; b < last; ++b) {
+            const auto block = stream.block(b);
+            const size_t count = stream.block_size(b);
+            pending.push_back(pool.submit([block, count, &stream] {
+                return decode_block(block, count, stream.channels, stream.bits_per_sample);
+            }));
+        }
+        for (size_t b = first; b < last; ++b) {
+            const std::vector<uint8_t> pcm = pending[b - first].get();
+            output_file.write(reinterpret_cast<const char *>(pcm.data()), static_cast<std::streamsize>(pcm.size()));
+        }
+    }
+    output_file.write(reinterpret_cast<const char *>(stream.trailer.data()), static_cast<std::streamsize>(stream.trailer.size()));
+    output_file.close();
+    send_message("WAV data saved to: " + output_filename + '\n');
+
     std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
-    int size_output = static_cast<int>(get_filesize(output_filename));
-    double ratio = static_cast<double>(size_output) / size_input;
+    const auto size_output = static_cast<size_t>(get_filesize(output_filename));
+    double ratio = static_cast<double>(size_output) / static_cast<double>(input.size());
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    auto info = CommonInformation(ratio,
-                                  duration.count(), size_input, size_output);
+    auto info = CommonInformation(ratio, static_cast<size_t>(duration.count()), input.size(), size_output);
     send_common_information(info);
-    send_global_params();
+}
+std::vector<int32_t> FlacAlgo::decode_range(const std::string &input_filename, uint64_t first_sample, uint64_t count)  {
+    const InputView input(input_filename);
+    if (!input.is_open()) {
+        throw std::runtime_error("Failed to open file: " + input_filename);
+    }
+    if (!check_format(input.bytes(), input_filename)) {
+        throw std::runtime_error("Not a supported FLAC file: " + input_filename);
+    }
+    const FlacStream stream = read_stream(input.bytes());
+    if (first_sample > stream.frames) {
+        throw std::runtime_error("FLAC range starts past the end of the stream");
+    }
+    count = std::min(count, stream.frames - first_sample);
+    std::vector<int32_t> samples(count * stream.channels);
+    if (count == 0) return samples;
+
+    // the seek point at or before first_sample, then only the blocks overlapping the range
+    const auto by_frame = [](uint64_t frame, const SeekPoint &point) { return frame < point.first_frame; };
+    size_t b = static_cast<size_t>(std::upper_bound(stream.seek.begin(), stream.seek.end(), first_sample, by_frame) - stream.seek.begin()) - 1;
+    const uint64_t end_sample = first_sample + count;
+    for (; b + 1 < stream.seek.size() && stream.seek[b].first_frame < end_sample; ++b) {
+        const std::vector<std::vector<int32_t>> decoded =
+                decode_block_channels(stream.block(b), stream.block_size(b), stream.channels, stream.bits_per_sample);
+        const uint64_t from = std::max(first_sample, stream.seek[b].first_frame);
+        const uint64_t to = std::min(end_sample, stream.seek[b + 1].first_frame);
+        for (uint64_t frame = from; frame < to; ++frame) {
+            for (unsigned c = 0; c < stream.channels; ++c) {
+                samples[(frame - first_sample) * stream.channels + c] = decoded[c][frame - stream.seek[b].first_frame];
+            }
+        }
+    }
+    return samples;
 }
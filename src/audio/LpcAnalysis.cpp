@@ -0,0 +1,158 @@
+#include <audio/LpcAnalysis.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ARCHIVATOR_LPC_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    /// Add `x[j] * x[j + lag]` for `j` in [first, n - lag) to @p acc, by ascending j.
+    inline double lag_tail(const float *x, size_t n, size_t first, unsigned lag, double acc) {
+        for (size_t j = first; j + lag < n; ++j) {
+            acc += static_cast<double>(x[j]) * x[j + lag];
+        }
+        return acc;
+    }
+
+    void autocorrelation_scalar(const float *x, size_t n, unsigned max_lag, double *r) {
+        for (unsigned lag = 0; lag <= max_lag; ++lag) {
+            r[lag] = lag_tail(x, n, 0, lag, 0.0);
+        }
+    }
+
+    void autocorrelation_generic(const float *x, size_t n, unsigned max_lag, double *r) {
+        constexpr unsigned kLags = 8; // independent add chains, enough to hide the latency of a double add
+        for (unsigned lag = 0; lag <= max_lag; lag += kLags) {
+            // x[j + lag + kLags - 1] must exist in the main loop; the remaining j of each lag are added one by one
+            const size_t end = n > lag + kLags - 1 ? n - lag - (kLags - 1) : 0;
+            double acc[kLags] = {};
+            for (size_t j = 0; j < end; ++j) {
+                const double xj = x[j];
+                for (unsigned i = 0; i < kLags; ++i) {
+                    acc[i] += xj * x[j + lag + i];
+                }
+            }
+            for (unsigned i = 0; i < kLags && lag + i <= max_lag; ++i) {
+                r[lag + i] = lag_tail(x, n, end, lag + i, acc[i]);
+            }
+        }
+    }
+
+#ifdef ARCHIVATOR_LPC_AVX2
+    __attribute__((target("avx2,fma"))) void autocorrelation_avx2(const float *x, size_t n, unsigned max_lag, double *r) {
+        for (unsigned lag = 0; lag <= max_lag; lag += 16) {
+            const size_t end = n > lag + 15 ? n - lag - 15 : 0;
+            __m256d acc0 = _mm256_setzero_pd();
+            __m256d acc1 = _mm256_setzero_pd();
+            __m256d acc2 = _mm256_setzero_pd();
+            __m256d acc3 = _mm256_setzero_pd();
+            for (size_t j = 0; j < end; ++j) {
+                // float * float is exact in double, so the FMA rounds exactly like the scalar multiply-add
+                const __m256d xj = _mm256_set1_pd(x[j]);
+                const float *p = x + j + lag;
+                acc0 = _mm256_fmadd_pd(xj, _mm256_cvtps_pd(_mm_loadu_ps(p)), acc0);
+                acc1 = _mm256_fmadd_pd(xj, _mm256_cvtps_pd(_mm_loadu_ps(p + 4)), acc1);
+                acc2 = _mm256_fmadd_pd(xj, _mm256_cvtps_pd(_mm_loadu_ps(p + 8)), acc2);
+                acc3 = _mm256_fmadd_pd(xj, _mm256_cvtps_pd(_mm_loadu_ps(p + 12)), acc3);
+            }
+            double acc[16];
+            _mm256_storeu_pd(acc, acc0);
+            _mm256_storeu_pd(acc + 4, acc1);
+            _mm256_storeu_pd(acc + 8, acc2);
+            _mm256_storeu_pd(acc + 12, acc3);
+            for (unsigned i = 0; i < 16 && lag + i <= max_lag; ++i) {
+                r[lag + i] = lag_tail(x, n, end, lag + i, acc[i]);
+            }
+        }
+    }
+#endif
+
+    bool cpu_has_avx2() {
+#ifdef ARCHIVATOR_LPC_AVX2
+        static const bool has = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return has;
+#else
+        return false;
+#endif
+    }
+}
+
+std::vector<float> LpcAnalysis::apply_window(std::span<const int32_t> samples, Window window) {
+    const size_t n = samples.size();
+    std::vector<float> x(n);
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = static_cast<float>(samples[i]);
+    }
+    if (n < 2) return x;
+    const double last = static_cast<double>(n - 1);
+    switch (window) {
+        case Window::Rectangle:
+            break;
+        case Window::Welch: {
+            const double half = last / 2;
+            for (size_t i = 0; i < n; ++i) {
+                const double t = (static_cast<double>(i) - half) / half;
+                x[i] *= static_cast<float>(1.0 - t * t);
+            }
+            break;
+        }
+        case Window::Tukey: {
+            // cosine tapers over kTukeyRatio / 2 of the block at each end, flat in between
+            const auto taper = static_cast<size_t>(kTukeyRatio / 2 * last);
+            for (size_t i = 0; i < taper; ++i) {
+                const auto w = static_cast<float>(0.5 - 0.5 * std::cos(std::numbers::pi * static_cast<double>(i) / static_cast<double>(taper)));
+                x[i] *= w;
+                x[n - 1 - i] *= w;
+            }
+            break;
+        }
+    }
+    return x;
+}
+LpcAnalysis::Kernel LpcAnalysis::best_kernel() {
+    return cpu_has_avx2() ? Kernel::Avx2 : Kernel::Generic;
+}
+void LpcAnalysis::autocorrelation(std::span<const float> x, unsigned max_lag, double *r) {
+    static const Kernel kernel = best_kernel();
+    autocorrelation(kernel, x, max_lag, r);
+}
+void LpcAnalysis::autocorrelation(Kernel kernel, std::span<const float> x, unsigned max_lag, double *r) {
+    if (kernel == Kernel::Avx2 && !cpu_has_avx2()) kernel = Kernel::Generic;
+    switch (kernel) {
+        case Kernel::Scalar:
+            autocorrelation_scalar(x.data(), x.size(), max_lag, r);
+            break;
+        case Kernel::Generic:
+            autocorrelation_generic(x.data(), x.size(), max_lag, r);
+            break;
+        case Kernel::Avx2:
+#ifdef ARCHIVATOR_LPC_AVX2
+            autocorrelation_avx2(x.data(), x.size(), max_lag, r);
+#endif
+            break;
+    }
+}
+unsigned LpcAnalysis::levinson_durbin(const double *r, unsigned max_order, double *coeffs, double *error) {
+    error[0] = r[0];
+    const double *previous = nullptr;
+    for (unsigned m = 1; m <= max_order; ++m) {
+        if (!(error[m - 1] > 0)) return m - 1;
+        double *current = coeffs + static_cast<size_t>(m - 1) * max_order;
+        double acc = r[m];
+        for (unsigned j = 1; j < m; ++j) {
+            acc -= previous[j - 1] * r[m - j];
+        }
+        const double k = acc / error[m - 1];
+        for (unsigned j = 1; j < m; ++j) {
+            current[j - 1] = previous[j - 1] - k * previous[m - j - 1];
+        }
+        current[m - 1] = k;
+        error[m] = (1 - k * k) * error[m - 1];
+        previous = current;
+    }
+    return max_order;
+}
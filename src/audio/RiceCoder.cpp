@@ -0,0 +1,81 @@
+#include <audio/RiceCoder.hpp>
+
+#include <algorithm>
+#include <bit>
+
+std::vector<uint32_t> RiceCoder::fold(std::span<const int32_t> values) {
+    std::vector<uint32_t> folded(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        folded[i] = fold(values[i]);
+    }
+    return folded;
+}
+uint64_t RiceCoder::cost(std::span<const uint32_t> folded, unsigned k, unsigned escape_bits) {
+    uint64_t bits = 0;
+    for (const uint32_t u: folded) {
+        const uint32_t q = u >> k;
+        bits += q < kEscapeRun ? q + 1 + k : kEscapeRun + escape_bits;
+    }
+    return bits;
+}
+unsigned RiceCoder::best_parameter(std::span<const uint32_t> folded, unsigned escape_bits) {
+    uint64_t sum = 0;
+    for (const uint32_t u: folded) {
+        sum += u;
+    }
+    // the mean gives the right k to within one; settle it with the exact cost
+    const uint64_t mean = folded.empty() ? 0 : sum / folded.size();
+    const unsigned guess = std::min<unsigned>(kMaxParameter, mean > 0 ? static_cast<unsigned>(std::bit_width(mean)) - 1 : 0);
+    unsigned best = guess;
+    uint64_t best_bits = cost(folded, guess, escape_bits);
+    for (const unsigned k: {guess - 1, guess + 1}) {
+        if (k > kMaxParameter) continue; // also rejects guess - 1 wrapping around below zero
+        const uint64_t bits = cost(folded, k, escape_bits);
+        if (bits < best_bits) {
+            best_bits = bits;
+            best = k;
+        }
+    }
+    return best;
+}
+void RiceCoder::encode_block(BitWriter &stream, std::span<const uint32_t> folded, unsigned k, unsigned escape_bits) {
+    const uint64_t mask = (uint64_t{1} << k) - 1;
+    for (const uint32_t u: folded) {
+        const uint32_t q = u >> k;
+        if (q >= kEscapeRun) {
+            stream.put_bits(0, kEscapeRun);
+            stream.put_bits(u, escape_bits);
+            continue;
+        }
+        // the terminating one and the remainder; the q leading zeros are implied by the width
+        const uint64_t code = (uint64_t{1} << k) | (u & mask);
+        const unsigned length = q + 1 + k;
+        if (length <= 32) {
+            stream.put_bits(code, length);
+        } else {
+            stream.put_bits(0, q);
+            stream.put_bits(code, k + 1);
+        }
+    }
+}
+void RiceCoder::decode_block(BitReader &stream, std::span<int32_t> out, unsigned k, unsigned escape_bits) {
+    static_assert(kEscapeRun + kMaxParameter <= 56); // the most BitReader::peek_bits() can return
+    // a code that is not escaped is at most kEscapeRun + k bits long, so one window holds both quotient and remainder;
+    // peeking no more than that keeps BitReader refills as rare as possible
+    const unsigned window_bits = kEscapeRun + k;
+    const uint64_t mask = (uint64_t{1} << k) - 1;
+    for (int32_t &value: out) {
+        // left-align the window so countl_zero counts the zero run directly
+        const uint64_t window = stream.peek_bits(window_bits) << (64 - window_bits);
+        const auto q = static_cast<unsigned>(std::countl_zero(window));
+        if (q >= kEscapeRun) {
+            stream.skip_bits(kEscapeRun);
+            value = unfold(static_cast<uint32_t>(stream.get_bits(escape_bits)));
+            continue;
+        }
+        const unsigned length = q + 1 + k;
+        const auto remainder = static_cast<uint32_t>((window >> (64 - length)) & mask);
+        stream.skip_bits(length);
+        value = unfold(q << k | remainder);
+    }
+}
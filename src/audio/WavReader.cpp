@@ -0,0 +1,138 @@
+#include <audio/WavReader.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    /// Read-ahead touches one byte per this many bytes (the smallest common page size).
+    constexpr size_t kPageBytes = 4096;
+}
+
+WavReader::WavReader(const std::string &filename) : input_(filename) {
+    if (!input_.is_open()) {
+        error_ = "Failed to open file: " + filename;
+        return;
+    }
+    open_ = parse();
+}
+WavReader::~WavReader() {
+    if (!prefetcher_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    ready_.notify_one();
+    prefetcher_.join();
+}
+WavReader::HeaderStatus WavReader::parse_header(std::span<const uint8_t> head, Format &format, std::string &error) {
+    constexpr uint16_t kFormatPcm = 1;
+    constexpr uint16_t kFormatExtensible = 0xFFFE;
+    auto read_u16 = [&head](size_t at) { uint16_t v; std::memcpy(&v, head.data() + at, sizeof(v)); return v; };
+    auto read_u32 = [&head](size_t at) { uint32_t v; std::memcpy(&v, head.data() + at, sizeof(v)); return v; };
+    auto is_id = [&head](size_t at, const char *id) { return std::memcmp(head.data() + at, id, 4) == 0; };
+
+    if (head.size() < 12) {
+        error = "Invalid WAV file format.";
+        return HeaderStatus::Incomplete;
+    }
+    if (!is_id(0, "RIFF") || !is_id(8, "WAVE")) {
+        error = "Invalid WAV file format.";
+        return HeaderStatus::Invalid;
+    }
+    bool have_format = false;
+    size_t offset = 12;
+    while (true) {
+        if (head.size() - offset < 8) {
+            error = "Invalid WAV file format: no data chunk.";
+            return HeaderStatus::Incomplete;
+        }
+        const uint32_t chunk_size = read_u32(offset + 4);
+        const size_t body = offset + 8;
+        if (is_id(offset, "data")) {
+            if (!have_format) {
+                error = "Invalid WAV file format: data chunk before fmt chunk.";
+                return HeaderStatus::Invalid;
+            }
+            format.data_offset = body;
+            format.data_bytes = chunk_size;
+            return HeaderStatus::Complete;
+        }
+        if (head.size() - body < chunk_size) {
+            error = "Invalid WAV file format: truncated chunk.";
+            return HeaderStatus::Incomplete;
+        }
+        if (is_id(offset, "fmt ")) {
+            if (chunk_size < 16) {
+                error = "Invalid WAV file format: short fmt chunk.";
+                return HeaderStatus::Invalid;
+            }
+            uint16_t audio_format = read_u16(body);
+            format.channels = read_u16(body + 2);
+            format.block_align = read_u16(body + 12);
+            format.bits_per_sample = read_u16(body + 14);
+            if (audio_format == kFormatExtensible && chunk_size >= 40) {
+                audio_format = read_u16(body + 24); // first two bytes of the sub-format GUID
+            }
+            if (audio_format != kFormatPcm || format.channels == 0 ||
+                (format.bits_per_sample != 16 && format.bits_per_sample != 24) ||
+                format.block_align != format.channels * (format.bits_per_sample / 8)) {
+                error = "Unsupported WAV format: only 16/24-bit PCM is supported.";
+                return HeaderStatus::Invalid;
+            }
+            have_format = true;
+        }
+        // chunks are padded to an even size; a pad byte that has not arrived yet is waited for like the next chunk
+        offset = body + chunk_size + (chunk_size & 1);
+        if (offset > head.size()) {
+            error = "Invalid WAV file format: no data chunk.";
+            return HeaderStatus::Incomplete;
+        }
+    }
+}
+bool WavReader::parse() {
+    const std::span<const uint8_t> file = input_.bytes();
+    Format format;
+    if (parse_header(file, format, error_) != HeaderStatus::Complete) {
+        return false;
+    }
+    channels_ = format.channels;
+    bits_per_sample_ = format.bits_per_sample;
+    block_align_ = format.block_align;
+    // a truncated file keeps its complete frames; the rest goes to the trailer
+    const size_t data_bytes = std::min<size_t>(format.data_bytes, file.size() - format.data_offset);
+    frames_ = data_bytes / block_align_;
+    prefix_ = file.first(format.data_offset);
+    pcm_ = file.subspan(format.data_offset, frames_ * block_align_);
+    trailer_ = file.subspan(format.data_offset + pcm_.size());
+    return true;
+}
+void WavReader::prefetch(size_t first_frame, size_t count) {
+    if (!input_.is_mapped() || first_frame >= frames_) return;
+    count = std::min<size_t>(count, frames_ - first_frame);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(pcm_.subspan(first_frame * block_align_, count * block_align_));
+        if (!prefetcher_.joinable()) {
+            prefetcher_ = std::thread(&WavReader::prefetch_loop, this);
+        }
+    }
+    ready_.notify_one();
+}
+void WavReader::prefetch_loop() {
+    while (true) {
+        std::span<const uint8_t> range;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+            if (stop_) return;
+            range = pending_.front();
+            pending_.pop_front();
+        }
+        // reading one byte per page makes the kernel fetch it; the sum only keeps the loads from being optimized out
+        uint8_t sink = 0;
+        for (size_t i = 0; i < range.size(); i += kPageBytes) {
+            sink ^= *static_cast<const volatile uint8_t *>(range.data() + i);
+        }
+        static_cast<void>(sink);
+    }
+}
@@ -9,6 +9,7 @@
 #include <video/QuantizationAlgo.hpp>
 #include <audio/FlacAlgo.hpp>
 #include <huffman/HuffmanAlgo.hpp>
+#include <rans/RansAlgo.hpp>
 
 
 void ::Controller::start(const std::string &str) {
@@ -67,9 +68,32 @@ void ::Controller::start(const std::string &str) {
                 try {
                     FractalAlgo fractal_algo{is_text_output, output_file, oss};
                     std::string arg_name = arg.files_[0];
-                    int quality = 600;
-                    if (!arg.options_.empty()) quality = stoi(arg.options_[0]);
-                    fractal_algo.encode(arg_name, quality);
+                    if (arg.action_) {
+                        //encode; -o [quality] [threads] [full|class|neighbours|nearest[=K]]
+                        int quality = 600;
+                        unsigned threads = 0;
+                        DomainSearch search = DomainSearch::Neighbours;
+                        unsigned nearest = QuadTreeEncoder::kNearestDomains;
+                        size_t position = 0;
+                        for (const std::string &option: arg.options_) {
+                            if (option == "full") search = DomainSearch::Full;
+                            else if (option == "class") search = DomainSearch::Class;
+                            else if (option == "neighbours") search = DomainSearch::Neighbours;
+                            else if (option == "nearest") search = DomainSearch::Nearest;
+                            else if (option.rfind("nearest=", 0) == 0) {
+                                search = DomainSearch::Nearest;
+                                nearest = static_cast<unsigned>(stoul(option.substr(8)));
+                            }
+                            else if (position++ == 0) quality = stoi(option);
+                            else threads = static_cast<unsigned>(stoi(option));
+                        }
+                        fractal_algo.encode(arg_name, quality, threads, search, nearest);
+                    } else {
+                        //decode; -o [phases]
+                        int phases = FractalAlgo::kDecodePhases;
+                        if (!arg.options_.empty()) phases = stoi(arg.options_[0]);
+                        fractal_algo.decode(arg_name, phases);
+                    }
                 } catch (std::exception const&) {
                     send_error_information("Error, need correct options: " + Dto::to_string(arg));
                 }
@@ -78,12 +102,27 @@ void ::Controller::start(const std::string &str) {
                 try {
                     FlacAlgo flac_algo{is_text_output, output_file, oss};
                     std::string arg_name = arg.files_[0];
-                    if (arg.action_) {
+                    // -o [fast] [threads] [stream] [block=N]: fixed predictors instead of LPC analysis, worker count,
+                    // encode the input as it arrives (pipe, FIFO, /dev/stdin) in blocks of N frames
+                    bool fast = false;
+                    bool stream = false;
+                    unsigned threads = 0;
+                    uint32_t block_frames = kStreamBlockFrames;
+                    for (const std::string &option: arg.options_) {
+                        if (option == "fast") fast = true;
+                        else if (option == "stream") stream = true;
+                        else if (option.rfind("block=", 0) == 0) block_frames = static_cast<uint32_t>(stoul(option.substr(6)));
+                        else threads = static_cast<unsigned>(stoi(option));
+                    }
+                    if (arg.action_ && stream) {
+                        //encode a stream
+                        flac_algo.encode_stream(arg_name, block_frames, fast);
+                    } else if (arg.action_) {
                         //encode
-                        flac_algo.encode(arg_name);
+                        flac_algo.encode(arg_name, threads, fast);
                     } else {
                         //decode
-                        flac_algo.decode(arg_name);
+                        flac_algo.decode(arg_name, threads);
                     }
                 } catch (std::exception const&) {
                     send_error_information("Error, need correct options: " + Dto::to_string(arg) + '\n');
@@ -93,12 +132,32 @@ void ::Controller::start(const std::string &str) {
                 try {
                     HuffmanAlgo huffman_algo{is_text_output, output_file, oss};
                     std::string arg_name = arg.files_[0];
+                    // -o block [threads]: independently coded blocks on a thread pool
+                    bool block_mode = !arg.options_.empty() && arg.options_[0] == "block";
+                    unsigned threads = 0;
+                    if (block_mode && arg.options_.size() > 1) threads = static_cast<unsigned>(stoi(arg.options_[1]));
+                    if (arg.action_) {
+                        //encode
+                        if (block_mode) huffman_algo.encode_blocks(arg_name, threads);
+                        else huffman_algo.encode(arg_name);
+                    } else {
+                        //decode
+                        huffman_algo.decode(arg_name, threads);
+                    }
+                } catch (std::exception const&) {
+                    send_error_information("Error, need correct options: " + Dto::to_string(arg) + '\n');
+                }
+                break;
+            case AlgorithmEnum::RANS:
+                try {
+                    RansAlgo rans_algo{is_text_output, output_file, oss};
+                    std::string arg_name = arg.files_[0];
                     if (arg.action_) {
                         //encode
-                        huffman_algo.encode(arg_name);
+                        rans_algo.encode(arg_name);
                     } else {
                         //decode
-                        huffman_algo.decode(arg_name);
+                        rans_algo.decode(arg_name);
                     }
                 } catch (std::exception const&) {
                     send_error_information("Error, need correct options: " + Dto::to_string(arg) + '\n');
@@ -1,5 +1,6 @@
 #include <controller/Selector.hpp>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <filesystem>
@@ -7,6 +8,11 @@
 
 AlgorithmEnum Selector::get_algorithm_from_dto(const Dto &dto) {
     std::string name = dto.files_[0];
+    if (dto.action_ && !dto.options_.empty() && dto.options_[0] == "rans")
+        return AlgorithmEnum::RANS;
+    // "-" или /dev/stdin не имеют расширения .wav, поэтому потоковое сжатие выбирается по опции
+    if (dto.action_ && std::find(dto.options_.begin(), dto.options_.end(), "stream") != dto.options_.end())
+        return AlgorithmEnum::FLAC;
     AlgorithmEnum algorithm = get_algorithm_from_name(name, dto.action_);
     return algorithm;
 }
@@ -27,7 +33,11 @@ AlgorithmEnum Selector::get_algorithm_from_name(const std::string &name, bool ac
         return AlgorithmEnum::QUANTIZATION;
     if (extension == ".flac")
         return AlgorithmEnum::FLAC;
+    if (extension == ".fic")
+        return AlgorithmEnum::FRACTAL;
     if (extension == ".hcf")
         return AlgorithmEnum::HUFFMAN;
+    if (extension == ".rans")
+        return AlgorithmEnum::RANS;
     return AlgorithmEnum::ERROR;
 }
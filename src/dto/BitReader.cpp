@@ -0,0 +1,42 @@
+#include <cstring>
+#include <dto/BitReader.hpp>
+
+BitReader::BitReader(std::istream &source, std::size_t buffer_bytes)
+    : data_(nullptr), size_(0), source_(&source), buffer_(buffer_bytes < 64 ? 64 : buffer_bytes) {
+    data_ = buffer_.data();
+    fill_buffer();
+}
+void BitReader::fill_buffer() {
+    const std::size_t rest = size_ - pos_;
+    std::memmove(buffer_.data(), buffer_.data() + pos_, rest);
+    base_ += pos_;
+    pos_ = 0;
+    source_->read(reinterpret_cast<char *>(buffer_.data() + rest), static_cast<std::streamsize>(buffer_.size() - rest));
+    size_ = rest + static_cast<std::size_t>(source_->gcount());
+    if (!*source_) {
+        source_ = nullptr;
+    }
+}
+void BitReader::refill() {
+    if (pos_ + 8 > size_ && source_ != nullptr) {
+        fill_buffer();
+    }
+    if (pos_ + 8 <= size_) {
+        // branchless refill: load 8 bytes big-endian, keep only whole bytes that fit
+        std::uint64_t word = 0;
+        for (int i = 0; i < 8; ++i) {
+            word = (word << 8) | data_[pos_ + i];
+        }
+        buf_ |= word >> avail_;
+        pos_ += (63 - avail_) >> 3;
+        avail_ |= 56;
+        return;
+    }
+    // tail of the data: byte by byte, zeros past the end
+    while (avail_ <= 56) {
+        const std::uint64_t byte = pos_ < size_ ? data_[pos_] : 0;
+        buf_ |= byte << (56 - avail_);
+        ++pos_;
+        avail_ += 8;
+    }
+}
@@ -0,0 +1,42 @@
+#include <dto/BitWriter.hpp>
+
+#include <vector>
+BitWriter::BitWriter(std::size_t reserve_bytes) {
+    // +4: the last flush_word() must never be the one that triggers a regrow
+    data_.resize(reserve_bytes + 4);
+}
+BitWriter::BitWriter(std::ostream &sink, std::size_t buffer_bytes) : sink_(&sink) {
+    data_.resize(buffer_bytes < 64 ? 64 : buffer_bytes);
+}
+void BitWriter::make_room() {
+    if (sink_ != nullptr) {
+        sink_->write(reinterpret_cast<const char *>(data_.data()), static_cast<std::streamsize>(size_));
+        flushed_ += size_;
+        size_ = 0;
+        return;
+    }
+    data_.resize(data_.size() < 64 ? 64 : data_.size() * 2);
+}
+std::vector<std::uint8_t> BitWriter::finish() {
+    // pad the pending bits up to a whole number of bytes and commit them one byte at a time
+    const unsigned pad = (8 - bits_ % 8) % 8;
+    acc_ <<= pad;
+    bits_ += pad;
+    if (size_ + 4 > data_.size()) make_room();
+    while (bits_ > 0) {
+        bits_ -= 8;
+        data_[size_++] = static_cast<std::uint8_t>(acc_ >> bits_);
+    }
+    std::vector<std::uint8_t> out;
+    if (sink_ != nullptr) {
+        sink_->write(reinterpret_cast<const char *>(data_.data()), static_cast<std::streamsize>(size_));
+    } else {
+        data_.resize(size_);
+        out = std::move(data_);
+        data_.clear();
+    }
+    size_ = 0;
+    flushed_ = 0;
+    acc_ = 0;
+    return out;
+}
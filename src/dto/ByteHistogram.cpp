@@ -0,0 +1,113 @@
+#include <dto/ByteHistogram.hpp>
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ARCHIVATOR_HISTOGRAM_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    /// Bytes counted before the 32-bit sub-histograms are merged, so that no counter can overflow.
+    constexpr size_t kChunkBytes = size_t{1} << 30;
+
+    using SubHistogram = uint32_t[256];
+
+    void count_scalar(const uint8_t *data, size_t size, SubHistogram *tables) {
+        for (size_t i = 0; i < size; ++i) {
+            tables[0][data[i]]++;
+        }
+    }
+
+    /// Count the 8 bytes of @p word into tables 0..3 (two increments per table).
+    inline void count_word(uint64_t word, SubHistogram *tables) {
+        tables[0][word & 0xFF]++;
+        tables[1][(word >> 8) & 0xFF]++;
+        tables[2][(word >> 16) & 0xFF]++;
+        tables[3][(word >> 24) & 0xFF]++;
+        tables[0][(word >> 32) & 0xFF]++;
+        tables[1][(word >> 40) & 0xFF]++;
+        tables[2][(word >> 48) & 0xFF]++;
+        tables[3][word >> 56]++;
+    }
+
+    void count_generic(const uint8_t *data, size_t size, SubHistogram *tables) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            uint64_t a;
+            uint64_t b;
+            std::memcpy(&a, data + i, 8);
+            std::memcpy(&b, data + i + 8, 8);
+            count_word(a, tables);
+            count_word(b, tables);
+        }
+        count_scalar(data + i, size - i, tables);
+    }
+
+#ifdef ARCHIVATOR_HISTOGRAM_AVX2
+    __attribute__((target("avx2"))) void count_avx2(const uint8_t *data, size_t size, SubHistogram *tables) {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            const __m256i first = _mm256_set1_epi8(static_cast<char>(data[i]));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, first)) == -1) {
+                // a run of one byte value: the worst case for the store-forwarding chain, one add here
+                tables[0][data[i]] += 32;
+                continue;
+            }
+            uint64_t words[4];
+            std::memcpy(words, data + i, sizeof(words));
+            count_word(words[0], tables);
+            count_word(words[1], tables + 4);
+            count_word(words[2], tables);
+            count_word(words[3], tables + 4);
+        }
+        count_scalar(data + i, size - i, tables);
+    }
+#endif
+
+    bool cpu_has_avx2() {
+#ifdef ARCHIVATOR_HISTOGRAM_AVX2
+        static const bool has = __builtin_cpu_supports("avx2");
+        return has;
+#else
+        return false;
+#endif
+    }
+}
+
+ByteHistogram::Kernel ByteHistogram::best_kernel() {
+    return cpu_has_avx2() ? Kernel::Avx2 : Kernel::Generic;
+}
+void ByteHistogram::count(const uint8_t *data, size_t size, uint64_t freq[256]) {
+    static const Kernel kernel = best_kernel();
+    count(kernel, data, size, freq);
+}
+void ByteHistogram::count(Kernel kernel, const uint8_t *data, size_t size, uint64_t freq[256]) {
+    if (kernel == Kernel::Avx2 && !cpu_has_avx2()) kernel = Kernel::Generic;
+    SubHistogram tables[8];
+    while (size > 0) {
+        const size_t n = size < kChunkBytes ? size : kChunkBytes;
+        std::memset(tables, 0, sizeof(tables));
+        switch (kernel) {
+            case Kernel::Scalar:
+                count_scalar(data, n, tables);
+                break;
+            case Kernel::Generic:
+                count_generic(data, n, tables);
+                break;
+            case Kernel::Avx2:
+#ifdef ARCHIVATOR_HISTOGRAM_AVX2
+                count_avx2(data, n, tables);
+#endif
+                break;
+        }
+        for (const auto &table: tables) {
+            for (unsigned c = 0; c < 256; ++c) {
+                freq[c] += table[c];
+            }
+        }
+        data += n;
+        size -= n;
+    }
+}
@@ -0,0 +1,59 @@
+#include <dto/InputView.hpp>
+
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ARCHIVATOR_INPUT_VIEW_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+InputView::InputView(const std::string &filename) {
+#ifdef ARCHIVATOR_INPUT_VIEW_MMAP
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info{};
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        open_ = true;
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ == 0) {
+            ::close(fd);
+            return;
+        }
+        void *map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            ::madvise(map, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const uint8_t *>(map);
+            mapped_ = true;
+            ::close(fd);
+            return;
+        }
+        open_ = false;
+        size_ = 0;
+    }
+    ::close(fd);
+#endif
+    read_buffered(filename);
+}
+InputView::~InputView() {
+#ifdef ARCHIVATOR_INPUT_VIEW_MMAP
+    if (mapped_) {
+        ::munmap(const_cast<uint8_t *>(data_), size_);
+    }
+#endif
+}
+void InputView::read_buffered(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return;
+    const std::streamsize size = file.tellg();
+    if (size < 0) return;
+    buffer_.resize(static_cast<size_t>(size));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char *>(buffer_.data()), size);
+    buffer_.resize(static_cast<size_t>(file.gcount()));
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    open_ = true;
+}
@@ -1,29 +1,45 @@
+#include <algorithm>
 #include <chrono>
-#include <queue>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <dto/ByteHistogram.hpp>
+#include <dto/InputView.hpp>
 #include <huffman/HuffmanAlgo.hpp>
 
-std::shared_ptr<HuffmanAlgo::HuffmanNode> HuffmanAlgo::build_huffman_tree(const std::vector<uint32_t>& freq){
-  std::priority_queue<
-          std::shared_ptr<HuffmanNode>,
-          std::vector<std::shared_ptr<HuffmanNode>>,
-          HuffmanNode::Cmp
-      > pq;
-
+uint16_t HuffmanAlgo::HuffmanTree::add(uint64_t freq, unsigned char data, uint16_t left, uint16_t right){
+  if (size >= kMaxNodes) throw std::runtime_error("corrupt Huffman tree");
+  nodes[size] = Node{freq, left, right, data};
+  return size++;
+}
+void HuffmanAlgo::build_huffman_tree(const std::vector<uint64_t>& freq, HuffmanTree& tree){
+  tree.size = 0;
+  tree.root = HuffmanTree::kNone;
   for (unsigned int i=0;i<256;i++) {
     if (freq[i] == 0) continue;
-    pq.push(std::make_shared<HuffmanNode>(HuffmanNode{static_cast<unsigned char>(i),freq[i]}));
+    tree.add(freq[i], static_cast<unsigned char>(i));
   }
+  const uint16_t leaves = tree.size;
+  if (leaves == 0) return;
+  std::sort(tree.nodes.begin(), tree.nodes.begin() + leaves, [](const HuffmanTree::Node& a, const HuffmanTree::Node& b) {
+    return a.freq != b.freq ? a.freq < b.freq : a.data < b.data;
+  });
 
-  if (pq.empty()) return {};
-  if (pq.size() == 1) return pq.top();
-
-  while (pq.size() > 1) {
-    auto a = pq.top(); pq.pop();
-    auto b = pq.top(); pq.pop();
-    auto parent = std::make_shared<HuffmanNode>(HuffmanNode{0,a->freq + b->freq,(std::move(a).get()),(std::move(b).get())});
-    pq.push(std::move(parent));
+  // queue 1: leaves [next_leaf, leaves); queue 2: internal nodes [next_inner, tree.size)
+  uint16_t next_leaf = 0;
+  uint16_t next_inner = leaves;
+  auto pop_min = [&]() -> uint16_t {
+    if (next_inner == tree.size || (next_leaf < leaves && tree.nodes[next_leaf].freq <= tree.nodes[next_inner].freq)) {
+      return next_leaf++;
+    }
+    return next_inner++;
+  };
+  while ((leaves - next_leaf) + (tree.size - next_inner) > 1) {
+    const uint16_t a = pop_min();
+    const uint16_t b = pop_min();
+    tree.add(tree.nodes[a].freq + tree.nodes[b].freq, 0, a, b);
   }
-  return pq.top();
+  tree.root = static_cast<uint16_t>(tree.size - 1);
 }
 void HuffmanAlgo::send_common_information(const CommonInformation& common_information)
 {
@@ -41,40 +57,134 @@ void HuffmanAlgo::send_error_information(const std::string& error)
   if (root->right!=nullptr){ clear_huffman_root(root->right); }
   delete root;
 }*/
-void HuffmanAlgo::write_tree_to_stream(const std::shared_ptr<HuffmanNode>& root, BitStream& stream)
+uint16_t HuffmanAlgo::read_tree_from_stream(BitReader& stream, HuffmanTree& tree)
 {
-  if (root == nullptr)
+  if (stream.get_bit()) {
+    const auto data = static_cast<unsigned char>(stream.get_bits(8));
+    return tree.add(0, data);
+  }
+
+  const uint16_t left  = read_tree_from_stream(stream, tree);
+  const uint16_t right = read_tree_from_stream(stream, tree);
+
+  return tree.add(0, '\0', left, right);
+}
+
+void HuffmanAlgo::collect_code_lengths(const HuffmanTree& tree, uint16_t node, unsigned depth, uint8_t len[256])
+{
+  if (tree.is_leaf(node)) {
+    len[tree.nodes[node].data] = static_cast<uint8_t>(depth);
     return;
-  if (root->left == nullptr && root->right == nullptr) {
-    stream.add_bit(true);
-    stream.add_byte(root->data);
-  } else {
-    stream.add_bit(false);
-    write_tree_to_stream(root->left, stream);
-    write_tree_to_stream(root->right, stream);
   }
+  collect_code_lengths(tree, tree.nodes[node].left, depth + 1, len);
+  collect_code_lengths(tree, tree.nodes[node].right, depth + 1, len);
 }
-std::shared_ptr<HuffmanAlgo::HuffmanNode> HuffmanAlgo::read_tree_from_stream(BitStream& stream)
+void HuffmanAlgo::compute_code_lengths(const std::vector<uint64_t>& freq, uint8_t len[256])
 {
-  if (stream.get_bit()) {
-    const unsigned char data = stream.get_byte();
-    return std::make_shared<HuffmanNode>(data, 0);
+  std::fill(len, len + 256, 0);
+  HuffmanTree tree;
+  build_huffman_tree(freq, tree);
+  if (tree.root == HuffmanTree::kNone) return;
+  if (tree.is_leaf(tree.root)) {
+    len[tree.nodes[tree.root].data] = 1;
+    return;
   }
+  collect_code_lengths(tree, tree.root, 0, len);
+  HuffmanCodeTable::limit_lengths(len, freq.data(), kMaxCodeLengthV2);
+}
+void HuffmanAlgo::write_code_lengths(BitWriter& stream, const uint8_t len[256])
+{
+  for (unsigned i = 0; i < 256; ++i) {
+    stream.put_bits(len[i], 4);
+  }
+}
+void HuffmanAlgo::read_code_lengths(BitReader& stream, uint8_t len[256])
+{
+  for (unsigned i = 0; i < 256; ++i) {
+    len[i] = static_cast<uint8_t>(stream.get_bits(4));
+  }
+}
+std::vector<uint8_t> HuffmanAlgo::encode_block(const uint8_t* data, size_t size)
+{
+  std::vector<uint64_t> frequencies(256);
+  ByteHistogram::count(data, size, frequencies.data());
+  uint8_t lengths[256];
+  compute_code_lengths(frequencies, lengths);
+  const HuffmanCodeTable codes = HuffmanCodeTable::canonical(lengths);
 
-  auto left  = read_tree_from_stream(stream);
-  auto right = read_tree_from_stream(stream);
-
-  return std::make_shared<HuffmanNode>('\0', 0, std::move(left).get(), std::move(right).get());
+  BitWriter bit_stream(size + 128);
+  write_code_lengths(bit_stream, lengths);
+  for (size_t i = 0; i < size; ++i) {
+    bit_stream.put_bits(codes.code[data[i]], codes.len[data[i]]);
+  }
+  return bit_stream.finish();
+}
+void HuffmanAlgo::decode_block(std::span<const uint8_t> packed, std::vector<uint8_t>& plain)
+{
+  BitReader bit_stream(packed.data(), packed.size());
+  uint8_t lengths[256];
+  read_code_lengths(bit_stream, lengths);
+  HuffmanDecodeTable table;
+  if (!table.build(HuffmanCodeTable::canonical(lengths))) throw std::runtime_error("corrupt Huffman stream");
+  table.decode_symbols(bit_stream, plain.size(), plain.data());
+  if (bit_stream.bits_consumed() > bit_stream.bits_total()) throw std::runtime_error("corrupt Huffman stream");
 }
+void HuffmanAlgo::decode_blocks(std::span<const uint8_t> data, std::ostream& out, unsigned threads)
+{
+  uint64_t count = 0;
+  uint32_t block_bytes = 0;
+  uint32_t block_count = 0;
+  constexpr size_t kHeaderBytes = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+  if (data.size() < kHeaderBytes) throw std::runtime_error("corrupt Huffman block header");
+  std::memcpy(&count, data.data(), sizeof(uint64_t));
+  std::memcpy(&block_bytes, data.data() + sizeof(uint64_t), sizeof(uint32_t));
+  std::memcpy(&block_count, data.data() + sizeof(uint64_t) + sizeof(uint32_t), sizeof(uint32_t));
+  data = data.subspan(kHeaderBytes);
+  if (block_bytes == 0 || (count + block_bytes - 1) / block_bytes != block_count ||
+      data.size() / sizeof(uint64_t) < block_count) {
+    throw std::runtime_error("corrupt Huffman block header");
+  }
+  std::vector<uint64_t> block_sizes(block_count);
+  std::memcpy(block_sizes.data(), data.data(), block_count * sizeof(uint64_t));
+  data = data.subspan(block_count * sizeof(uint64_t));
+
+  // blocks are slices of the input; only the decoded output of one wave is held in memory
+  std::vector<std::span<const uint8_t>> packed(block_count);
+  for (size_t b = 0; b < block_count; ++b) {
+    if (block_sizes[b] > data.size()) throw std::runtime_error("truncated Huffman block");
+    packed[b] = data.first(block_sizes[b]);
+    data = data.subspan(block_sizes[b]);
+  }
 
-void HuffmanAlgo::generate_codes(const std::shared_ptr<HuffmanNode>& node, const std::string& code, std::map<unsigned char, std::string>& codes)
+  ThreadPool pool(threads);
+  const size_t wave = 2 * static_cast<size_t>(pool.size());
+  std::vector<std::vector<uint8_t>> plain(wave);
+  std::vector<std::future<void>> pending;
+  for (size_t first = 0; first < block_count; first += wave) {
+    const size_t last = std::min<size_t>(first + wave, block_count);
+    pending.clear();
+    for (size_t b = first; b < last; ++b) {
+      const auto in = packed[b];
+      auto& res = plain[b - first];
+      res.resize(std::min<uint64_t>(block_bytes, count - b * block_bytes));
+      pending.push_back(pool.submit([in, &res] { decode_block(in, res); }));
+    }
+    for (size_t b = first; b < last; ++b) {
+      pending[b - first].get();
+      out.write(reinterpret_cast<const char *>(plain[b - first].data()), static_cast<std::streamsize>(plain[b - first].size()));
+    }
+  }
+}
+bool HuffmanAlgo::collect_codes(const HuffmanTree& tree, uint16_t node, uint32_t code, unsigned depth, HuffmanCodeTable& table)
 {
-  if (node == nullptr) return;
-  if (node->left == nullptr && node->right == nullptr) {
-    codes[node->data] = code;
+  if (tree.is_leaf(node)) {
+    table.code[tree.nodes[node].data] = code;
+    table.len[tree.nodes[node].data] = static_cast<uint8_t>(depth);
+    return true;
   }
-  generate_codes(node->left, code + "0", codes);
-  generate_codes(node->right, code + "1", codes);
+  if (depth >= HuffmanDecodeTable::kMaxCodeLength) return false;
+  return collect_codes(tree, tree.nodes[node].left, code << 1, depth + 1, table) &&
+         collect_codes(tree, tree.nodes[node].right, (code << 1) | 1, depth + 1, table);
 }
 void HuffmanAlgo::encode(const std::string& input_filename, const std::string& mod, int size_input1, long duration1)
 {
@@ -90,36 +200,33 @@ void HuffmanAlgo::encode(const std::string& input_filename, const std::string& m
                 last_slash_pos != std::string::npos ? input_filename.substr(last_slash_pos + 1) : input_filename;
         std::string output_filename = "storageEncoded/" + tmpinput_filename + ".hcf";// путь сохранения
 
-        std::ifstream input_file(input_filename, std::ios::binary);
-        std::string text((std::istreambuf_iterator<char>(input_file)), (std::istreambuf_iterator<char>()));
-        input_file.close();
-        std::vector<uint32_t> frequencies(256);
-        for (unsigned char c: text) {
-          frequencies[c]++;
+        const InputView input(input_filename);
+        if (!input.is_open()) {
+            send_error_information("Failed to open file: " + input_filename + '\n');
+            exit(-1);
         }
+        const std::span<const uint8_t> data = input.bytes();
 
-        auto root = build_huffman_tree(frequencies);
-        std::map<unsigned char, std::string> codes;
+        // pass 1: byte histogram
+        std::vector<uint64_t> frequencies(256);
+        ByteHistogram::count(data.data(), data.size(), frequencies.data());
+        const uint64_t count = data.size();
 
-        generate_codes(root, "", codes);
+        uint8_t lengths[256];
+        compute_code_lengths(frequencies, lengths);
+        const HuffmanCodeTable codes = HuffmanCodeTable::canonical(lengths);
 
-        BitStream bit_stream{};
-        write_tree_to_stream(root, bit_stream);
-        //clear_huffman_root(root);
+        // pass 2: codes go straight to the output file through the writer's fixed buffer
+        if (std::ofstream output_file(output_filename, std::ios::binary);output_file.is_open()) {
+            output_file.write(reinterpret_cast<const char *>(kHcfMagicV2.data()), kHcfMagicV2.size());
+            output_file.write(reinterpret_cast<const char *>(&count), sizeof(uint64_t));
 
-        for (unsigned char c: text) {
-            std::string code = codes[c];
-            for (unsigned char bit: code) {
-                bit_stream.add_bit(bit - static_cast<unsigned char>('0'));
+            BitWriter bit_stream(output_file, kStreamBufferBytes);
+            write_code_lengths(bit_stream, lengths);
+            for (const uint8_t c: data) {
+                bit_stream.put_bits(codes.code[c], codes.len[c]);
             }
-        }
-
-        if (std::ofstream output_file(output_filename, std::ios::binary);output_file.is_open()) {
-            size_t size = bit_stream.data.size();
-            output_file.write(reinterpret_cast<const char *>(&size), sizeof(size_t));
-            uint8_t a = size * 8 - bit_stream.bit_index;
-            output_file.write(reinterpret_cast<const char *>(&a), sizeof(uint8_t));
-            output_file.write(reinterpret_cast<const char *>(bit_stream.data.data()), size);
+            bit_stream.finish();
             output_file.close();
             send_message(mod + " data saved to: " + output_filename + '\n');
         } else {
@@ -137,7 +244,67 @@ void HuffmanAlgo::encode(const std::string& input_filename, const std::string& m
         send_message("}\n");
 
     }
-void HuffmanAlgo::decode(const std::string& input_filename)
+void HuffmanAlgo::encode_blocks(const std::string& input_filename, unsigned threads)
+{
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t last_slash_pos = input_filename.find_last_of('/');
+        std::string tmpinput_filename =
+                last_slash_pos != std::string::npos ? input_filename.substr(last_slash_pos + 1) : input_filename;
+        std::string output_filename = "storageEncoded/" + tmpinput_filename + ".hcf";// путь сохранения
+
+        const InputView input(input_filename);
+        if (!input.is_open()) {
+            send_error_information("Failed to open file: " + input_filename + '\n');
+            exit(-1);
+        }
+        std::ofstream output_file(output_filename, std::ios::binary);
+        if (!output_file.is_open()) {
+            send_error_information("Failed to write Huffman file.\n");
+            exit(-1);
+        }
+        const std::span<const uint8_t> data = input.bytes();
+        const uint64_t count = data.size();
+        const uint32_t block_bytes = kBlockBytes;
+        const auto block_count = static_cast<uint32_t>((count + block_bytes - 1) / block_bytes);
+        output_file.write(reinterpret_cast<const char *>(kHcfMagicV3.data()), kHcfMagicV3.size());
+        output_file.write(reinterpret_cast<const char *>(&count), sizeof(uint64_t));
+        output_file.write(reinterpret_cast<const char *>(&block_bytes), sizeof(uint32_t));
+        output_file.write(reinterpret_cast<const char *>(&block_count), sizeof(uint32_t));
+
+        // the index is only known once every block is coded: reserve it now, fill it in at the end
+        const auto index_pos = output_file.tellp();
+        std::vector<uint64_t> block_sizes(block_count);
+        output_file.write(reinterpret_cast<const char *>(block_sizes.data()), static_cast<std::streamsize>(block_count * sizeof(uint64_t)));
+
+        ThreadPool pool(threads);
+        const size_t wave = 2 * static_cast<size_t>(pool.size());
+        std::vector<std::future<std::vector<uint8_t>>> pending;
+        for (size_t first = 0; first < block_count; first += wave) {
+            const size_t last = std::min<size_t>(first + wave, block_count);
+            pending.clear();
+            for (size_t b = first; b < last; ++b) {
+                const auto in = data.subspan(b * block_bytes, std::min<uint64_t>(block_bytes, count - b * block_bytes));
+                pending.push_back(pool.submit([in] { return encode_block(in.data(), in.size()); }));
+            }
+            for (size_t b = first; b < last; ++b) {
+                const std::vector<uint8_t> packed = pending[b - first].get();
+                block_sizes[b] = packed.size();
+                output_file.write(reinterpret_cast<const char *>(packed.data()), static_cast<std::streamsize>(packed.size()));
+            }
+        }
+        output_file.seekp(index_pos);
+        output_file.write(reinterpret_cast<const char *>(block_sizes.data()), static_cast<std::streamsize>(block_count * sizeof(uint64_t)));
+        output_file.close();
+        send_message("Huffman data saved to: " + output_filename + '\n');
+
+        const auto size_output = static_cast<uint64_t>(get_filesize(output_filename));
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        double ratio = static_cast<double>(size_output) / static_cast<double>(count);
+        auto info = CommonInformation(ratio, static_cast<size_t>(duration.count()), count, size_output);
+        send_common_information(info);
+    }
+void HuffmanAlgo::decode(const std::string& input_filename, unsigned threads)
 {
         auto start = std::chrono::high_resolution_clock::now();
         int size_input = static_cast<int>(get_filesize(input_filename));
@@ -147,35 +314,69 @@ void HuffmanAlgo::decode(const std::string& input_filename)
         size_t pos = tmp_input_filename.rfind(".hcf");
         std::string output_filename = "storageDecoded/" + tmp_input_filename.substr(0, pos);// путь сохранения
 
-        std::ofstream out_file(output_filename, std::ios::binary);
+        const InputView input(input_filename);
+        if (!input.is_open()) {
+            send_error_information("Failed to open file: " + input_filename + '\n');
+            exit(-1);
+        }
+        std::span<const uint8_t> data = input.bytes();
+        if (data.size() < 9) throw std::runtime_error("truncated Huffman file");
 
-        std::ifstream input_file(input_filename, std::ios::binary);
+        std::ofstream out_file(output_filename, std::ios::binary);
 
-        size_t size;
-        input_file.read(reinterpret_cast<char *>(&size), sizeof(size_t));
+        std::array<uint8_t, 8> magic{};
+        std::memcpy(magic.data(), data.data(), magic.size());
+        data = data.subspan(magic.size());
 
-        uint8_t max_idx = 0;
-        input_file.read(reinterpret_cast<char *>(&max_idx), sizeof(uint8_t));
+        if (magic == kHcfMagicV2) {
+            if (data.size() < sizeof(uint64_t)) throw std::runtime_error("truncated Huffman file");
+            uint64_t count = 0;
+            std::memcpy(&count, data.data(), sizeof(uint64_t));
+            data = data.subspan(sizeof(uint64_t));
+            // every code is at least one bit long
+            if (count > data.size() * 8) throw std::runtime_error("corrupt Huffman stream");
 
-        std::vector<uint8_t> data(size);
-        input_file.read(reinterpret_cast<char *>(data.data()), size);
+            BitReader bit_stream(data.data(), data.size());
+            uint8_t lengths[256];
+            read_code_lengths(bit_stream, lengths);
+            HuffmanDecodeTable table;
+            if (!table.build(HuffmanCodeTable::canonical(lengths))) throw std::runtime_error("corrupt Huffman stream");
+            table.decode_symbols(bit_stream, count, out_file);
+            if (bit_stream.bits_consumed() > bit_stream.bits_total()) throw std::runtime_error("corrupt Huffman stream");
+        } else if (magic == kHcfMagicV3) {
+            decode_blocks(data, out_file, threads);
+        } else {
+            // version 1: size of the encoded data, padding bit count, serialized tree + codes
+            size_t size;
+            std::memcpy(&size, magic.data(), sizeof(size_t));
 
-        input_file.close();
+            const uint8_t max_idx = data[0];
+            data = data.subspan(1);
 
-        BitStream bit_stream(data);
+            BitReader bit_stream(data.data(), data.size());
 
-        auto root = read_tree_from_stream(bit_stream);
-        auto current = root;
+            HuffmanTree tree;
+            const uint16_t root = read_tree_from_stream(bit_stream, tree);
+            const size_t end_bit = size * 8 - max_idx;
 
-        while (bit_stream.bit_index < bit_stream.data.size() * 8 - max_idx) {
-            if (bit_stream.get_bit()) {
-                current = current->right;
-            } else {
-                current = current->left;
+            HuffmanCodeTable codes;
+            HuffmanDecodeTable table;
+            if (!tree.is_leaf(root) && collect_codes(tree, root, 0, 0, codes) && table.build(codes)) {
+                table.decode(bit_stream, end_bit, out_file);
             }
-            if (current->left == nullptr && current->right == nullptr) {
-                out_file << current->data;
-                current = root;
+            uint16_t current = root;
+
+            while (bit_stream.bits_consumed() < end_bit) {
+                if (bit_stream.get_bit()) {
+                    current = tree.nodes[current].right;
+                } else {
+                    current = tree.nodes[current].left;
+                }
+                if (current == HuffmanTree::kNone) throw std::runtime_error("corrupt Huffman stream");
+                if (tree.is_leaf(current)) {
+                    out_file << tree.nodes[current].data;
+                    current = root;
+                }
             }
         }
         out_file.close();
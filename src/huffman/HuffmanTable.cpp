@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <huffman/HuffmanTable.hpp>
+
+HuffmanCodeTable HuffmanCodeTable::canonical(const uint8_t len[256])
+{
+  uint32_t bl_count[33] = {};
+  for (int s = 0; s < 256; ++s) bl_count[len[s]]++;
+  bl_count[0] = 0;
+
+  uint64_t next_code[33] = {};
+  uint64_t code = 0;
+  for (int bits = 1; bits <= 32; ++bits) {
+    code = (code + bl_count[bits - 1]) << 1;
+    next_code[bits] = code;
+  }
+
+  HuffmanCodeTable table;
+  for (int s = 0; s < 256; ++s) {
+    if (len[s] == 0) continue;
+    table.len[s] = len[s];
+    table.code[s] = static_cast<uint32_t>(next_code[len[s]]++);
+  }
+  return table;
+}
+
+void HuffmanCodeTable::limit_lengths(uint8_t len[256], const uint64_t freq[256], unsigned max_len)
+{
+  const unsigned longest = *std::max_element(len, len + 256);
+  if (longest <= max_len) return;
+
+  uint32_t bl_count[256] = {};
+  std::vector<int> symbols;
+  for (int s = 0; s < 256; ++s) {
+    if (len[s] == 0) continue;
+    bl_count[len[s]]++;
+    symbols.push_back(s);
+  }
+  for (unsigned i = longest; i > max_len; --i) {
+    while (bl_count[i] > 0) {
+      unsigned j = i - 2;
+      while (bl_count[j] == 0) --j;
+      bl_count[i] -= 2;     // two leaves leave the deepest level...
+      bl_count[i - 1] += 1; // ...one of them replaces their parent
+      bl_count[j + 1] += 2; // the other one and a former leaf at depth j
+      bl_count[j] -= 1;     // share the children of that leaf
+    }
+  }
+
+  std::stable_sort(symbols.begin(), symbols.end(), [&](int a, int b) { return freq[a] > freq[b]; });
+  size_t next = 0;
+  for (unsigned l = 1; l <= max_len; ++l) {
+    for (uint32_t k = 0; k < bl_count[l]; ++k) {
+      len[symbols[next++]] = static_cast<uint8_t>(l);
+    }
+  }
+}
+
+bool HuffmanDecodeTable::build(const HuffmanCodeTable& codes)
+{
+  constexpr unsigned kSize = 1u << kPrimaryBits;
+  // Kraft: Σ2^-l <= 1, counted in units of 2^-kMaxCodeLength; otherwise canonical codes overflow their length
+  // and would index past the tables below
+  uint64_t kraft = 0;
+  for (uint8_t l : codes.len) {
+    if (l > kMaxCodeLength) return false;
+    if (l != 0) kraft += uint64_t{1} << (kMaxCodeLength - l);
+  }
+  if (kraft > (uint64_t{1} << kMaxCodeLength)) return false;
+  primary_.assign(kSize, Entry{});
+  overflow_.clear();
+
+  // codes that fit into the primary window: replicate over all trailing bit patterns
+  std::vector<uint8_t> sub_bits(kSize, 0);
+  for (int s = 0; s < 256; ++s) {
+    const unsigned l = codes.len[s];
+    if (l == 0) continue;
+    if (l > kPrimaryBits) {
+      const uint32_t prefix = codes.code[s] >> (l - kPrimaryBits);
+      sub_bits[prefix] = std::max<uint8_t>(sub_bits[prefix], static_cast<uint8_t>(l - kPrimaryBits));
+      continue;
+    }
+    const uint32_t first = codes.code[s] << (kPrimaryBits - l);
+    for (uint32_t i = 0; i < (1u << (kPrimaryBits - l)); ++i) {
+      Entry& e = primary_[first + i];
+      e.symbols[0] = static_cast<uint8_t>(s);
+      e.count = 1;
+      e.first_len = static_cast<uint8_t>(l);
+      e.total_len = static_cast<uint8_t>(l);
+    }
+  }
+
+  // longer codes: one overflow table per primary prefix, as wide as its longest code
+  for (uint32_t prefix = 0; prefix < kSize; ++prefix) {
+    if (sub_bits[prefix] == 0) continue;
+    primary_[prefix].sub_bits = sub_bits[prefix];
+    primary_[prefix].sub_offset = static_cast<uint16_t>(overflow_.size());
+    overflow_.resize(overflow_.size() + (size_t{1} << sub_bits[prefix]));
+  }
+  for (int s = 0; s < 256; ++s) {
+    const unsigned l = codes.len[s];
+    if (l <= kPrimaryBits) continue;
+    const unsigned rest = l - kPrimaryBits;
+    const Entry& link = primary_[codes.code[s] >> rest];
+    const uint32_t suffix = codes.code[s] & ((1u << rest) - 1);
+    const uint32_t first = link.sub_offset + (suffix << (link.sub_bits - rest));
+    for (uint32_t i = 0; i < (1u << (link.sub_bits - rest)); ++i) {
+      Entry& e = overflow_[first + i];
+      e.symbols[0] = static_cast<uint8_t>(s);
+      e.count = 1;
+      e.first_len = static_cast<uint8_t>(l);
+      e.total_len = static_cast<uint8_t>(l);
+    }
+  }
+
+  // pack a second symbol when its whole code is inside the remaining window bits
+  for (uint32_t i = 0; i < kSize; ++i) {
+    Entry& e = primary_[i];
+    if (e.count != 1 || e.first_len == kPrimaryBits) continue;
+    const unsigned rest = kPrimaryBits - e.first_len;
+    const Entry& next = primary_[(i << e.first_len) & (kSize - 1)];
+    if (next.count == 0 || next.first_len > rest) continue;
+    e.symbols[1] = next.symbols[0];
+    e.count = 2;
+    e.total_len = static_cast<uint8_t>(e.first_len + next.first_len);
+  }
+  return true;
+}
+
+bool HuffmanDecodeTable::decode_one(BitReader& reader, size_t end_bit, uint8_t& symbol) const
+{
+  const size_t remaining = end_bit - reader.bits_consumed();
+  const Entry& e = primary_[reader.peek_bits(kPrimaryBits)];
+  if (e.count != 0) {
+    if (e.first_len > remaining) return false;
+    symbol = e.symbols[0];
+    reader.skip_bits(e.first_len);
+    return true;
+  }
+  if (e.sub_bits == 0) return false;
+  const auto sub = static_cast<uint32_t>(reader.peek_bits(kPrimaryBits + e.sub_bits)) & ((1u << e.sub_bits) - 1);
+  const Entry& s = overflow_[e.sub_offset + sub];
+  if (s.count == 0 || s.total_len > remaining) return false;
+  symbol = s.symbols[0];
+  reader.skip_bits(s.total_len);
+  return true;
+}
+
+void HuffmanDecodeTable::decode(BitReader& reader, size_t end_bit, std::ostream& out) const
+{
+  constexpr size_t kBlockSize = 1 << 16;
+  // +1: a pair entry may write one symbol past kBlockSize before the flush check
+  std::vector<char> block(kBlockSize + 1);
+  size_t filled = 0;
+
+  // fast path: far enough from the end that no lookup can run past end_bit
+  while (reader.bits_consumed() + kMaxCodeLength <= end_bit) {
+    const Entry& e = primary_[reader.peek_bits(kPrimaryBits)];
+    if (e.count != 0) {
+      block[filled] = static_cast<char>(e.symbols[0]);
+      block[filled + 1] = static_cast<char>(e.symbols[1]);
+      filled += e.count;
+      reader.skip_bits(e.total_len);
+    } else {
+      uint8_t symbol = 0;
+      if (!decode_one(reader, end_bit, symbol)) throw std::runtime_error("corrupt Huffman stream");
+      block[filled++] = static_cast<char>(symbol);
+    }
+    if (filled >= kBlockSize) {
+      out.write(block.data(), static_cast<std::streamsize>(filled));
+      filled = 0;
+    }
+  }
+  // tail: one symbol at a time so the pair shortcut never reads padding bits
+  while (reader.bits_consumed() < end_bit) {
+    uint8_t symbol = 0;
+    if (!decode_one(reader, end_bit, symbol)) throw std::runtime_error("corrupt Huffman stream");
+    block[filled++] = static_cast<char>(symbol);
+    if (filled >= kBlockSize) {
+      out.write(block.data(), static_cast<std::streamsize>(filled));
+      filled = 0;
+    }
+  }
+  out.write(block.data(), static_cast<std::streamsize>(filled));
+}
+
+void HuffmanDecodeTable::decode_symbols(BitReader& reader, uint64_t count, std::ostream& out) const
+{
+  constexpr size_t kBlockSize = 1 << 16;
+  std::vector<uint8_t> block(kBlockSize);
+  while (count > 0) {
+    const size_t n = count < kBlockSize ? static_cast<size_t>(count) : kBlockSize;
+    decode_symbols(reader, n, block.data());
+    out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(n));
+    count -= n;
+  }
+}
+void HuffmanDecodeTable::decode_symbols(BitReader& reader, size_t count, uint8_t* out) const
+{
+  size_t produced = 0;
+
+  // fast path: a pair entry can never overshoot the symbol count
+  while (produced + 2 <= count) {
+    const Entry& e = primary_[reader.peek_bits(kPrimaryBits)];
+    if (e.count != 0) {
+      out[produced] = e.symbols[0];
+      out[produced + 1] = e.symbols[1];
+      produced += e.count;
+      reader.skip_bits(e.total_len);
+    } else {
+      if (!decode_one(reader, SIZE_MAX, out[produced])) throw std::runtime_error("corrupt Huffman stream");
+      ++produced;
+    }
+  }
+  if (produced < count) {
+    if (!decode_one(reader, SIZE_MAX, out[produced])) throw std::runtime_error("corrupt Huffman stream");
+  }
+}
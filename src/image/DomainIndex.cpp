@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+#include <image/DomainIndex.hpp>
+
+int DomainIndex::dimension(int block_size) noexcept {
+    const int side = std::min(kFeatureSide, block_size);
+    return side * side;
+}
+
+bool DomainIndex::feature(const pixel_value* block, int stride, int block_size, Feature& out) noexcept {
+    const int side = std::min(kFeatureSide, block_size);
+    const int cell = block_size / side;
+    const int dim = side * side;
+    // суммы по ячейкам: нормировка всё равно убирает масштаб, делить на площадь ячейки не нужно
+    float mean = 0;
+    for (int cy = 0; cy < side; ++cy) {
+        for (int cx = 0; cx < side; ++cx) {
+            int sum = 0;
+            for (int y = cy * cell; y < (cy + 1) * cell; ++y) {
+                for (int x = cx * cell; x < (cx + 1) * cell; ++x) {
+                    sum += block[static_cast<size_t>(y) * stride + x];
+                }
+            }
+            out[static_cast<size_t>(cy * side + cx)] = static_cast<float>(sum);
+            mean += static_cast<float>(sum);
+        }
+    }
+    mean /= static_cast<float>(dim);
+    float norm = 0;
+    for (int i = 0; i < dim; ++i) {
+        out[static_cast<size_t>(i)] -= mean;
+        norm += out[static_cast<size_t>(i)] * out[static_cast<size_t>(i)];
+    }
+    if (norm < 1e-6f) return false;
+    const float inverse = 1.0f / std::sqrt(norm);
+    for (int i = 0; i < dim; ++i) {
+        out[static_cast<size_t>(i)] *= inverse;
+    }
+    return true;
+}
+
+DomainIndex::DomainIndex(const DomainPool& pool)
+    : block_size_(pool.block_size())
+    , dimension_(dimension(pool.block_size()))
+{
+    points_.reserve(2 * static_cast<size_t>(pool.size()));
+    for (int i = 0; i < pool.size(); ++i) {
+        Point point{};
+        point.domain = i;
+        if (!feature(pool.pixels(i), block_size_, block_size_, point.feature)) continue;
+        points_.push_back(point);
+        // −d̂ — тот же домен с отрицательным масштабом
+        for (int j = 0; j < dimension_; ++j) {
+            point.feature[static_cast<size_t>(j)] = -point.feature[static_cast<size_t>(j)];
+        }
+        points_.push_back(point);
+    }
+    axis_.resize(points_.size());
+    build(0, points_.size());
+}
+
+void DomainIndex::build(size_t first, size_t last) {
+    if (last - first <= 1) {
+        if (first < last) axis_[first] = 0;
+        return;
+    }
+    // ось с наибольшим разбросом
+    int axis = 0;
+    float widest = -1;
+    for (int a = 0; a < dimension_; ++a) {
+        float low = points_[first].feature[static_cast<size_t>(a)];
+        float high = low;
+        for (size_t p = first + 1; p < last; ++p) {
+            low = std::min(low, points_[p].feature[static_cast<size_t>(a)]);
+            high = std::max(high, points_[p].feature[static_cast<size_t>(a)]);
+        }
+        if (high - low > widest) {
+            widest = high - low;
+            axis = a;
+        }
+    }
+    const size_t middle = first + (last - first) / 2;
+    std::nth_element(points_.begin() + static_cast<std::ptrdiff_t>(first), points_.begin() + static_cast<std::ptrdiff_t>(middle),
+                     points_.begin() + static_cast<std::ptrdiff_t>(last), [axis](const Point& a, const Point& b) {
+                         return a.feature[static_cast<size_t>(axis)] < b.feature[static_cast<size_t>(axis)];
+                     });
+    axis_[middle] = static_cast<unsigned char>(axis);
+    build(first, middle);
+    build(middle + 1, last);
+}
+
+std::vector<int> DomainIndex::nearest(const pixel_value* range, int range_stride, size_t k) const {
+    Feature query{};
+    if (k == 0 || points_.empty() || !feature(range, range_stride, block_size_, query)) return {};
+
+    // k лучших точек: вершина кучи — самая дальняя из найденных (при равенстве — с большим номером домена)
+    using Candidate = std::pair<float, int>;
+    std::priority_queue<Candidate> best;
+    auto search = [&](auto&& self, size_t first, size_t last) -> void {
+        if (first >= last) return;
+        const size_t middle = first + (last - first) / 2;
+        const Point& point = points_[middle];
+        float distance = 0;
+        for (int j = 0; j < dimension_; ++j) {
+            const float d = query[static_cast<size_t>(j)] - point.feature[static_cast<size_t>(j)];
+            distance += d * d;
+        }
+        const Candidate candidate{distance, point.domain};
+        if (best.size() < k) {
+            best.push(candidate);
+        } else if (candidate < best.top()) {
+            best.pop();
+            best.push(candidate);
+        }
+        const auto axis = static_cast<size_t>(axis_[middle]);
+        const float diff = query[axis] - point.feature[axis];
+        const bool left_first = diff < 0;
+        if (left_first) self(self, first, middle);
+        else self(self, middle + 1, last);
+        if (best.size() < k || diff * diff < best.top().first) {
+            if (left_first) self(self, middle + 1, last);
+            else self(self, first, middle);
+        }
+    };
+    search(search, 0, points_.size());
+
+    std::vector<int> domains;
+    domains.reserve(best.size());
+    while (!best.empty()) {
+        domains.push_back(best.top().second);
+        best.pop();
+    }
+    // d̂ и −d̂ одного домена дают один кандидат
+    std::sort(domains.begin(), domains.end());
+    domains.erase(std::unique(domains.begin(), domains.end()), domains.end());
+    return domains;
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <image/DomainPool.hpp>
+#include <image/IFSTransform.hpp>
+
+namespace {
+// номер перестановки четырёх квадрантов (код Лемера), 0..23
+int permutation_rank(const std::array<int, 4>& order) {
+    static constexpr int kFactorial[] = {6, 2, 1, 0};
+    int rank = 0;
+    for (int i = 0; i < 3; ++i) {
+        int smaller = 0;
+        for (int j = i + 1; j < 4; ++j) {
+            smaller += order[static_cast<size_t>(j)] < order[static_cast<size_t>(i)];
+        }
+        rank += smaller * kFactorial[i];
+    }
+    return rank;
+}
+
+std::array<int, 4> permutation_of_rank(int rank) {
+    static constexpr int kFactorial[] = {6, 2, 1, 1};
+    std::array<int, 4> order{};
+    std::array<bool, 4> used{};
+    for (int i = 0; i < 4; ++i) {
+        int skip = rank / kFactorial[i];
+        rank %= kFactorial[i];
+        for (int q = 0; q < 4; ++q) {
+            if (used[static_cast<size_t>(q)]) continue;
+            if (skip-- == 0) {
+                order[static_cast<size_t>(i)] = q;
+                used[static_cast<size_t>(q)] = true;
+                break;
+            }
+        }
+    }
+    return order;
+}
+}
+
+int DomainPool::classify(const pixel_value* block, int stride, int block_size) noexcept {
+    const int half = block_size / 2;
+    std::array<int64_t, 4> sum{};
+    std::array<int64_t, 4> sum_sq{};
+    for (int y = 0; y < block_size; ++y) {
+        for (int x = 0; x < block_size; ++x) {
+            const auto q = static_cast<size_t>((y >= half) * 2 + (x >= half));
+            const int p = block[static_cast<size_t>(y) * stride + x];
+            sum[q] += p;
+            sum_sq[q] += p * p;
+        }
+    }
+    // квадранты по убыванию яркости; при равенстве — в порядке обхода, чтобы класс был детерминирован
+    std::array<int, 4> order = {0, 1, 2, 3};
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return sum[static_cast<size_t>(a)] > sum[static_cast<size_t>(b)]; });
+    // площади квадрантов равны, так что сравниваем n·Σp² − (Σp)² вместо дисперсии
+    const int64_t area = static_cast<int64_t>(half) * half;
+    int most_varied = 0;
+    int64_t best_variance = -1;
+    for (size_t q = 0; q < 4; ++q) {
+        const int64_t variance = area * sum_sq[q] - sum[q] * sum[q];
+        if (variance > best_variance) {
+            best_variance = variance;
+            most_varied = static_cast<int>(q);
+        }
+    }
+    return permutation_rank(order) * 4 + most_varied;
+}
+
+int DomainPool::inverse_class(int block_class) noexcept {
+    std::array<int, 4> order = permutation_of_rank(block_class / 4);
+    std::reverse(order.begin(), order.end());
+    return permutation_rank(order) * 4 + block_class % 4;
+}
+
+std::vector<int> DomainPool::neighbour_classes(int block_class) {
+    const int ordering = block_class / 4;
+    const int most_varied = block_class % 4;
+    std::vector<int> classes;
+    for (int q = 0; q < 4; ++q) {
+        classes.push_back(ordering * 4 + q);
+    }
+    const std::array<int, 4> order = permutation_of_rank(ordering);
+    for (size_t i = 0; i + 1 < 4; ++i) {
+        std::array<int, 4> swapped = order;
+        std::swap(swapped[i], swapped[i + 1]);
+        classes.push_back(permutation_rank(swapped) * 4 + most_varied);
+    }
+    return classes;
+}
+
+DomainPool::DomainPool(const pixel_value* down_plane, int down_width, int block_size)
+    : block_size_(block_size)
+    , area_(block_size * block_size)
+    , grid_(down_width / block_size)
+    , pixels_(static_cast<size_t>(grid_) * grid_ * area_)
+    , sum_(static_cast<size_t>(grid_) * grid_)
+    , sum_sq_(static_cast<size_t>(grid_) * grid_)
+    , members_(kClasses)
+{
+    for (int i = 0; i < size(); ++i) {
+        // тайл домена в даунсэмпле начинается с (x/2, y/2)
+        const pixel_value* src = down_plane + static_cast<size_t>(y(i) / 2) * down_width + x(i) / 2;
+        pixel_value* dst = pixels_.data() + static_cast<size_t>(i) * area_;
+        int64_t sum = 0;
+        int64_t sum_sq = 0;
+        for (int row = 0; row < block_size_; ++row) {
+            std::memcpy(dst + row * block_size_, src + static_cast<size_t>(row) * down_width, static_cast<size_t>(block_size_));
+            for (int col = 0; col < block_size_; ++col) {
+                const int d = src[static_cast<size_t>(row) * down_width + col];
+                sum += d;
+                sum_sq += d * d;
+            }
+        }
+        sum_[static_cast<size_t>(i)] = sum;
+        sum_sq_[static_cast<size_t>(i)] = sum_sq;
+        members_[static_cast<size_t>(classify(dst, block_size_, block_size_))].push_back(i);
+    }
+}
+
+int64_t DomainPool::dot(const pixel_value* range, int range_stride, int i) const noexcept {
+    const pixel_value* d = pixels(i);
+    int64_t sum = 0;
+    for (int row = 0; row < block_size_; ++row) {
+        const pixel_value* r = range + static_cast<size_t>(row) * range_stride;
+        // строка не больше 32 пикселей: 32 * 255 * 255 помещается в int, так что внутренний цикл векторизуется
+        int row_sum = 0;
+        for (int col = 0; col < block_size_; ++col) {
+            row_sum += r[col] * d[col];
+        }
+        sum += row_sum;
+        d += block_size_;
+    }
+    return sum;
+}
+
+DomainPool::Fit DomainPool::fit(int i, int64_t sum_r, int64_t sum_rr, int64_t sum_rd) const noexcept {
+    const auto n = static_cast<double>(area_);
+    const auto sr = static_cast<double>(sum_r);
+    const auto sd = static_cast<double>(sum(i));
+    const auto sdd = static_cast<double>(sum_sq(i));
+    const auto srd = static_cast<double>(sum_rd);
+
+    // s = (nΣrd - ΣrΣd) / (nΣd² - (Σd)²), o = (Σr - sΣd) / n
+    const double denominator = n * sdd - sd * sd;
+    const double raw_scale = denominator > 0 ? (n * srd - sr * sd) / denominator : 0.0;
+    Fit result{};
+    result.scale_index = IFSTransform::quantize_scale(raw_scale);
+    result.scale = IFSTransform::dequantize_scale(result.scale_index);
+    result.offset_index = IFSTransform::quantize_offset(static_cast<int>(std::lround((sr - result.scale * sd) / n)));
+    result.offset = IFSTransform::dequantize_offset(result.offset_index);
+
+    // Σ(s·d + o - r)² = s²Σd² + n·o² + Σr² + 2s·oΣd - 2sΣrd - 2oΣr
+    const double s = result.scale;
+    const auto o = static_cast<double>(result.offset);
+    const double squared = s * s * sdd + n * o * o + static_cast<double>(sum_rr) + 2 * s * o * sd - 2 * s * srd - 2 * o * sr;
+    result.error = std::max(squared, 0.0) / n;
+    return result;
+}
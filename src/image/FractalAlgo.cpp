@@ -1,13 +1,19 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
 #include <vector>
 #include <string>
 #include <fstream>
+#include <dto/InputView.hpp>
 #include <image/Image.hpp>
 #include <image/IFSTransform.hpp>
 #include <image/QuadTreeEncoder.hpp>
 #include <image/Decoder.hpp>
 #include <chrono>
 #include <controller/IController.hpp>
-#include <huffman/HuffmanAlgo.hpp>
 #include <image/FractalAlgo.hpp>
 namespace fs = std::filesystem;
 void ::FractalAlgo::send_error_information(const std::string& error){
@@ -34,9 +40,68 @@ void ::FractalAlgo::send_decoded_information(int width, int height, int phases)
   std::string tmp = oss.str();
   send_message(tmp);
 }
-void ::FractalAlgo::encode(const std::string& input_filename, int quality) const {
+unsigned FractalAlgo::domain_bits(int image_size, int block_size) {
+  const int n = QuadTreeEncoder::domain_grid(image_size, block_size);
+  const auto domains = static_cast<unsigned>(n * n);
+  return domains > 1 ? static_cast<unsigned>(std::bit_width(domains - 1)) : 0;
+}
+void FractalAlgo::write_node(BitWriter& stream, const transform& leaves, size_t& next, int x, int y, int block_size, int image_size) {
+  if (next >= leaves.size()) {
+    throw std::runtime_error("quadtree leaves do not tile the image");
+  }
+  const IFSTransform& leaf = *leaves[next];
+  if (static_cast<int>(leaf.to_x) != x || static_cast<int>(leaf.to_y) != y || static_cast<int>(leaf.size) > block_size) {
+    throw std::runtime_error("quadtree leaves do not tile the image");
+  }
+  const bool split = static_cast<int>(leaf.size) < block_size;
+  if (block_size > 2) {
+    stream.put_bit(split);
+  } else if (split) {
+    throw std::runtime_error("quadtree leaves do not tile the image");
+  }
+  if (split) {
+    const int half = block_size / 2;
+    write_node(stream, leaves, next, x, y, half, image_size);
+    write_node(stream, leaves, next, x + half, y, half, image_size);
+    write_node(stream, leaves, next, x, y + half, half, image_size);
+    write_node(stream, leaves, next, x + half, y + half, half, image_size);
+    return;
+  }
+  const int domain_side = 2 * block_size;
+  const int n = QuadTreeEncoder::domain_grid(image_size, block_size);
+  const auto domain = static_cast<uint64_t>(leaf.from_y / domain_side * n + leaf.from_x / domain_side);
+  stream.put_bits(domain, domain_bits(image_size, block_size));
+  stream.put_bits(static_cast<uint64_t>(leaf.symmetry), IFSTransform::kSymmetryBits);
+  stream.put_bits(static_cast<uint64_t>(IFSTransform::quantize_scale(leaf.scale)), IFSTransform::kScaleBits);
+  stream.put_bits(static_cast<uint64_t>(IFSTransform::quantize_offset(leaf.offset)), IFSTransform::kOffsetBits);
+  ++next;
+}
+void FractalAlgo::read_node(BitReader& stream, transform& out, int x, int y, int block_size, int image_size) {
+  if (block_size > 2 && stream.get_bit()) {
+    const int half = block_size / 2;
+    read_node(stream, out, x, y, half, image_size);
+    read_node(stream, out, x + half, y, half, image_size);
+    read_node(stream, out, x, y + half, half, image_size);
+    read_node(stream, out, x + half, y + half, half, image_size);
+    return;
+  }
+  const int domain_side = 2 * block_size;
+  const int n = QuadTreeEncoder::domain_grid(image_size, block_size);
+  const auto domain = static_cast<int>(stream.get_bits(domain_bits(image_size, block_size)));
+  const auto symmetry = static_cast<int>(stream.get_bits(IFSTransform::kSymmetryBits));
+  const auto scale = static_cast<int>(stream.get_bits(IFSTransform::kScaleBits));
+  const auto offset = static_cast<int>(stream.get_bits(IFSTransform::kOffsetBits));
+  if (domain >= n * n || symmetry > IFSTransform::SYM_RDFLIP || scale > 2 * IFSTransform::kScaleSteps) {
+    throw std::runtime_error("corrupt .fic file");
+  }
+  out.push_back(std::make_unique<IFSTransform>(domain % n * domain_side, domain / n * domain_side, x, y, block_size,
+                                               static_cast<IFSTransform::Sym>(symmetry),
+                                               IFSTransform::dequantize_scale(scale),
+                                               IFSTransform::dequantize_offset(offset)));
+}
+void ::FractalAlgo::encode(const std::string& input_filename, int quality, unsigned threads, DomainSearch search, unsigned nearest) {
         auto start = std::chrono::high_resolution_clock::now();
-        int size_input = static_cast<int>(get_filesize(input_filename));
+        const auto size_input = static_cast<size_t>(get_filesize(input_filename));
         send_message("\nEncoding:\n");
         size_t last_slash_pos = input_filename.find_last_of('/');
         std::string tmp_input_filename =
@@ -46,26 +111,150 @@ void ::FractalAlgo::encode(const std::string& input_filename, int quality) const
         size_t pos = tmp_input_filename.rfind('.');
         auto source = Image{is_text_output, output_file, oss};
         source.image_setup(input_filename);
-        auto enc =  QuadTreeEncoder{is_text_output, output_file, oss, quality};
+        auto enc =  QuadTreeEncoder{is_text_output, output_file, oss, quality, threads, search, nearest};
         source.load();
 
         int width = source.width;
         int height = source.height;
+        // заголовок .fic хранит размеры в uint16_t; дополненная сторона не меньше исходных
+        if (source.source_width > UINT16_MAX || source.source_height > UINT16_MAX || width > UINT16_MAX || height > UINT16_MAX) {
+            send_error_information("Error: Image too large for .fic (" + std::to_string(width) + "x" + std::to_string(height) +
+                                   " padded, at most " + std::to_string(UINT16_MAX) + "): " + input_filename + "\n");
+            throw std::runtime_error("image too large for .fic");
+        }
         auto transforms = enc.encode(source);
-        size_t num_transforms = transforms->ch[0].size() +
-                               transforms->ch[1].size() + transforms->ch[2].size();
-        send_encoded_information(width, height, static_cast<int>(num_transforms));
-        auto dec = Decoder{width, height, transforms->channels, is_text_output, output_file, oss};
-        for (int phase = 1; phase <= 5; phase++) {
-            dec.decode(*transforms);
+        send_encoded_information(width, height, transforms->get_size());
+
+        BitWriter stream;
+        for (int channel = 0; channel < transforms->channels; ++channel) {
+            size_t next = 0;
+            for (int y = 0; y < height; y += BUFFER_SIZE) {
+                for (int x = 0; x < width; x += BUFFER_SIZE) {
+                    write_node(stream, transforms->ch[channel], next, x, y, BUFFER_SIZE, width);
+                }
+            }
+        }
+        const std::vector<uint8_t> bits = stream.finish();
+
+        std::string output_filename = "storageEncoded/" + tmp_input_filename.substr(0, pos) + ".fic";// путь сохранения
+        std::ofstream output(output_filename, std::ios::binary);
+        if (!output.is_open()) {
+            send_error_information("Error: Could not open output file: " + output_filename + "\n");
+            throw std::runtime_error("cannot open output file");
         }
-        std::string output_filename = "storageEncoded/" + tmp_input_filename.substr(0, pos) +'.' +source.extension;// путь сохранения
-        auto producer = dec.get_new_image(output_filename, 0);
-        producer->save();
-        HuffmanAlgo huffman_algo{is_text_output, output_file, oss};
+        const auto source_width = static_cast<uint16_t>(source.source_width);
+        const auto source_height = static_cast<uint16_t>(source.source_height);
+        const auto size = static_cast<uint16_t>(width);
+        const auto channels = static_cast<uint8_t>(transforms->channels);
+        const auto root_block = static_cast<uint8_t>(BUFFER_SIZE);
+        const auto extension_length = static_cast<uint8_t>(source.extension.size());
+        output.write(reinterpret_cast<const char*>(kFicMagic.data()), kFicMagic.size());
+        output.write(reinterpret_cast<const char*>(&source_width), sizeof(uint16_t));
+        output.write(reinterpret_cast<const char*>(&source_height), sizeof(uint16_t));
+        output.write(reinterpret_cast<const char*>(&size), sizeof(uint16_t));
+        output.write(reinterpret_cast<const char*>(&channels), sizeof(uint8_t));
+        output.write(reinterpret_cast<const char*>(&root_block), sizeof(uint8_t));
+        output.write(reinterpret_cast<const char*>(&extension_length), sizeof(uint8_t));
+        output.write(source.extension.data(), extension_length);
+        output.write(reinterpret_cast<const char*>(bits.data()), static_cast<std::streamsize>(bits.size()));
+        output.close();
+        send_message("Fractal data saved to: " + output_filename + "\n");
+
         std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
-        long duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        const auto size_output = static_cast<size_t>(get_filesize(output_filename));
+        const double ratio = static_cast<double>(size_output) / static_cast<double>(size_input);
+        const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        send_common_information(CommonInformation{ratio, static_cast<size_t>(duration.count()), size_input, size_output});
+    }
+void ::FractalAlgo::decode(const std::string& input_filename, int phases) {
+        auto start = std::chrono::high_resolution_clock::now();
+        send_message("\nDecoding:\n");
+        const InputView input(input_filename);
+        if (!input.is_open()) {
+            send_error_information("Error: Could not open input file: " + input_filename + "\n");
+            throw std::runtime_error("cannot open input file");
+        }
+        const std::span<const uint8_t> data = input.bytes();
+        constexpr size_t kFixedHeaderBytes = kFicMagic.size() + 3 * sizeof(uint16_t) + 3 * sizeof(uint8_t);
+        if (data.size() < kFixedHeaderBytes || !std::equal(kFicMagic.begin(), kFicMagic.end() - 1, data.begin())) {
+            send_error_information("Error: Not a .fic file: " + input_filename + "\n");
+            throw std::runtime_error("not a .fic file");
+        }
+        if (data[kFicMagic.size() - 1] != kFicFormatVersion) {
+            send_error_information("Error: Unsupported .fic version " + std::to_string(data[kFicMagic.size() - 1]) + "\n");
+            throw std::runtime_error("unsupported .fic version");
+        }
+        size_t offset = kFicMagic.size();
+        auto read = [&](void* out, size_t bytes) {
+            std::memcpy(out, data.data() + offset, bytes);
+            offset += bytes;
+        };
+        uint16_t source_width = 0, source_height = 0, size = 0;
+        uint8_t channels = 0, root_block = 0, extension_length = 0;
+        read(&source_width, sizeof(uint16_t));
+        read(&source_height, sizeof(uint16_t));
+        read(&size, sizeof(uint16_t));
+        read(&channels, sizeof(uint8_t));
+        read(&root_block, sizeof(uint8_t));
+        read(&extension_length, sizeof(uint8_t));
+        if (!(channels == 1 || channels == 3) || root_block != BUFFER_SIZE || size == 0 || size % BUFFER_SIZE != 0 ||
+            source_width == 0 || source_width > size || source_height == 0 || source_height > size ||
+            data.size() - offset < extension_length) {
+            send_error_information("Error: Corrupt .fic header: " + input_filename + "\n");
+            throw std::runtime_error("corrupt .fic file");
+        }
+        const std::string extension(reinterpret_cast<const char*>(data.data() + offset), extension_length);
+        offset += extension_length;
+
+        Transforms transforms;
+        transforms.channels = channels;
+        BitReader stream(data.data() + offset, data.size() - offset);
+        try {
+            for (int channel = 0; channel < channels; ++channel) {
+                for (int y = 0; y < size; y += BUFFER_SIZE) {
+                    for (int x = 0; x < size; x += BUFFER_SIZE) {
+                        read_node(stream, transforms.ch[channel], x, y, BUFFER_SIZE, size);
+                    }
+                }
+            }
+            if (stream.bits_consumed() > stream.bits_total()) {
+                throw std::runtime_error("corrupt .fic file");
+            }
+        } catch (const std::runtime_error&) {
+            send_error_information("Error: Corrupt .fic data: " + input_filename + "\n");
+            throw;
+        }
+
+        auto dec = Decoder{size, size, channels, is_text_output, output_file, oss};
+        for (int phase = 1; phase <= phases; phase++) {
+            dec.decode(transforms);
+        }
+        const auto decoded = dec.get_new_image("", 0);
 
-        huffman_algo.encode(output_filename,"Fractal",size_input,duration);
-        remove(output_filename.c_str());
+        // обрезаем паддинг, добавленный Image::load
+        size_t last_slash_pos = input_filename.find_last_of('/');
+        std::string tmp_input_filename =
+                last_slash_pos != std::string::npos ? input_filename.substr(last_slash_pos + 1) : input_filename;
+        std::string output_filename = "storageDecoded/" + tmp_input_filename.substr(0, tmp_input_filename.rfind('.')) + '.' + extension;
+        auto result = Image{is_text_output, output_file, oss};
+        result.image_setup(output_filename);
+        result.width = source_width;
+        result.height = source_height;
+        const pixel_value* planes[] = {decoded->image_data1, decoded->image_data2, decoded->image_data3};
+        std::vector<pixel_value> cropped(static_cast<size_t>(source_width) * source_height);
+        for (int channel = 0; channel < channels; ++channel) {
+            for (int y = 0; y < source_height; ++y) {
+                std::memcpy(cropped.data() + static_cast<size_t>(y) * source_width,
+                            planes[channel] + static_cast<size_t>(y) * size, source_width);
+            }
+            result.set_channel_data(channel + 1, cropped.data(), static_cast<int>(cropped.size()));
+        }
+        result.save();
+        send_decoded_information(source_width, source_height, phases);
+
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        const auto size_output = static_cast<size_t>(get_filesize(output_filename));
+        const double ratio = static_cast<double>(size_output) / static_cast<double>(input.size());
+        const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        send_common_information(CommonInformation{ratio, static_cast<size_t>(duration.count()), input.size(), size_output});
     }
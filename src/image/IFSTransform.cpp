@@ -1,7 +1,19 @@
 #include <vector>
 #include <algorithm>
+#include <cmath>
 #include <image/IFSTransform.hpp>
 
+int IFSTransform::quantize_scale(double scale) noexcept {
+    const double clamped = std::clamp(scale, -1.0, 1.0);
+    return static_cast<int>(std::lround(clamped * kScaleSteps)) + kScaleSteps;
+}
+
+int IFSTransform::quantize_offset(int offset) noexcept {
+    constexpr int kLevels = 1 << kOffsetBits;
+    const int q = static_cast<int>(std::lround(static_cast<double>(offset - kMinOffset) / kOffsetStep));
+    return std::clamp(q, 0, kLevels - 1);
+}
+
 std::vector<pixel_value>
 IFSTransform::down_sample(const pixel_value* src,
                           int src_width,
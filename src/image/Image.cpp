@@ -60,6 +60,8 @@ void Image::load() {
 
     width = w;
     height = h;
+    source_width = w;
+    source_height = h;
     channels = ch;                       // как есть из файла (обычно 1 или 3)
     original_size = width * height * channels;
 
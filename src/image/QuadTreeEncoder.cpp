@@ -1,12 +1,18 @@
 // QuadTreeEncoder.cpp
 #include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <future>
 #include <memory>
 #include <stdexcept>
 #include <vector>
 
 #include <image/Image.hpp>
 #include <image/IFSTransform.hpp>
+#include <image/DomainPool.hpp>
+#include <image/DomainIndex.hpp>
 #include <image/QuadTreeEncoder.hpp>
+#include <parallel/ThreadPool.hpp>
 
 // encode: читает исходный Image по константной ссылке, возвращает владение Transforms через unique_ptr
 std::unique_ptr<Transforms> QuadTreeEncoder::encode(const Image& source)
@@ -27,33 +33,52 @@ std::unique_ptr<Transforms> QuadTreeEncoder::encode(const Image& source)
 
     const int plane   = img.width * img.height;
     const int down_w  = img.width  / 2;
-    const int down_h  = img.height / 2;
 
+    // 1) Локальные копии каналов (range-плоскости) и пулы доменов для каждого размера блока; живут, пока работают задачи
+    std::vector<std::vector<pixel_value>> ranges(static_cast<size_t>(img.channels));
+    std::vector<std::vector<DomainPool>> pools(static_cast<size_t>(img.channels));
+    std::vector<std::vector<DomainIndex>> indices(static_cast<size_t>(img.channels));
     for (int channel = 1; channel <= img.channels; ++channel) {
-        // 1) Локальная копия канала (range-плоскость)
-        std::vector<pixel_value> range(static_cast<size_t>(plane));
+        auto& range = ranges[channel - 1];
+        range.resize(static_cast<size_t>(plane));
         // NB: get_channel_data пишет size байт; в проекте size == width*height
         const_cast<Image&>(source).get_channel_data(channel, range.data(), plane);
-
-        std::unique_ptr<pixel_value[]> down(
-            (IFSTransform::down_sample(range.data(), img.width, /*x*/0, /*y*/0, /*newWidth*/down_w).data())
-        );
-        if (!down) {
-            send_error_information("Error: down_sample returned null\n");
-            throw std::runtime_error("down_sample failed");
+        const std::vector<pixel_value> down = IFSTransform::down_sample(range.data(), img.width, /*x*/0, /*y*/0, /*newWidth*/down_w);
+        for (int block_size = BUFFER_SIZE; block_size >= 2; block_size /= 2) {
+            pools[channel - 1].emplace_back(down.data(), down_w, block_size);
+            if (search_ == DomainSearch::Nearest) {
+                indices[channel - 1].emplace_back(pools[channel - 1].back());
+            }
         }
+    }
 
-        // 3) Обход всех range-блоков N x N
+    // 2) Каждый range-блок верхнего уровня каждого канала — отдельная задача со своим списком трансформов;
+    //    списки склеиваются в порядке обхода, поэтому результат не зависит от числа потоков
+    ThreadPool pool(threads_);
+    std::vector<std::vector<std::future<transform>>> pending(static_cast<size_t>(img.channels));
+    for (int channel = 1; channel <= img.channels; ++channel) {
+        const pixel_value* range = ranges[channel - 1].data();
+        const std::vector<DomainPool>* domains = &pools[channel - 1];
+        const std::vector<DomainIndex>* index = &indices[channel - 1];
         for (int y = 0; y < img.height; y += BUFFER_SIZE) {
             for (int x = 0; x < img.width; x += BUFFER_SIZE) {
-                find_matches_for(transforms->ch[channel - 1],
-                                 x, y, BUFFER_SIZE,
-                                 range.data(), img.width,
-                                 down.get(),  down_w,
-                                 img.height);
+                pending[channel - 1].push_back(pool.submit([this, x, y, range, domains, index] {
+                    transform out;
+                    find_matches_for(out, x, y, BUFFER_SIZE,
+                                     range, img.width,
+                                     *domains, *index);
+                    return out;
+                }));
+            }
+        }
+    }
+    for (int channel = 1; channel <= img.channels; ++channel) {
+        auto& out = transforms->ch[channel - 1];
+        for (auto& task : pending[channel - 1]) {
+            for (auto& t : task.get()) {
+                out.push_back(std::move(t));
             }
         }
-        // RAII: vector/unique_ptr освободят ресурсы по выходу из scope
     }
 
     return transforms;
@@ -63,87 +88,94 @@ void QuadTreeEncoder::find_matches_for(transform& out,
                                        int to_x, int to_y,
                                        int block_size,
                                        const pixel_value* range_plane, int range_stride,
-                                       const pixel_value* down_plane,  int down_stride,
-                                       int image_height)
+                                       const std::vector<DomainPool>& domains,
+                                       const std::vector<DomainIndex>& index)
 {
-    if (!range_plane || !down_plane) {
+    if (!range_plane) {
         send_error_information("Error: find_matches_for null plane\n");
         throw std::invalid_argument("null plane");
     }
-    if (block_size <= 0 || range_stride <= 0 || down_stride <= 0) {
+    // пулы идут от BUFFER_SIZE вниз, по одному на каждое деление пополам
+    const auto level = static_cast<size_t>(std::countr_zero(static_cast<unsigned>(BUFFER_SIZE / block_size)));
+    if (block_size <= 0 || range_stride <= 0 || level >= domains.size() || domains[level].block_size() != block_size ||
+        (search_ == DomainSearch::Nearest && level >= index.size())) {
         send_error_information("Error: find_matches_for invalid strides/sizes\n");
         throw std::invalid_argument("invalid stride/size");
     }
+    const DomainPool& pool = domains[level];
+
+    // Σr и Σr² range-блока считаются один раз; на каждый домен остаётся только Σrd
+    const pixel_value* range = range_plane + static_cast<size_t>(to_y) * range_stride + to_x;
+    int64_t sum_r = 0;
+    int64_t sum_rr = 0;
+    for (int y = 0; y < block_size; ++y) {
+        for (int x = 0; x < block_size; ++x) {
+            const int r = range[static_cast<size_t>(y) * range_stride + x];
+            sum_r += r;
+            sum_rr += r * r;
+        }
+    }
 
-    int best_x = 0;
-    int best_y = 0;
-    int best_offset = 0;
-    IFSTransform::Sym best_symmetry = IFSTransform::SYM_NONE;
-    double best_scale = 0.0;
-    double best_error = 1e9;
-
-    // Буфер под домен-блок после трансформации (N x N)
-    std::vector<pixel_value> buffer(static_cast<size_t>(block_size) * block_size);
-
-    // Среднее для range-блока
-    const int range_avg = get_average_pixel(range_plane, range_stride,
-                                            to_x, to_y, block_size);
-
-    // Перебор всех домен-блоков в даунсэмпле (шаг = block_size по полной картинке → /2 в даунсэмпле)
-    for (int y = 0; y < image_height; y += block_size * 2) {
-        for (int x = 0; x < range_stride; x += block_size * 2) {
-            const int dx = x / 2; // координаты в downsample-плоскости
-            const int dy = y / 2;
-
-            // Временный трансформ (RAII)
-             constexpr auto symmetry_enum = IFSTransform::SYM_NONE;
-            IFSTransform ifs(dx, dy, /*to_x*/0, /*to_y*/0,
-                             block_size, symmetry_enum,
-                             /*scale*/1.0, /*offset*/0);
-
-            // Применяем трансформ: из down_plane (stride=down_stride) в buffer (stride=block_size)
-            ifs.execute(down_plane, down_stride,
-                        buffer.data(), block_size,
-                        /*isDownSampled*/ true);
-
-            const int domain_avg = get_average_pixel(buffer.data(), block_size, 0, 0, block_size);
-
-            const double scale = get_scale_factor(range_plane,  range_stride, to_x, to_y, range_avg,
-                                                  buffer.data(), block_size,   0,    0,   domain_avg,
-                                                  block_size);
-
-            const int offset = static_cast<int>(range_avg - scale * static_cast<double>(domain_avg));
-
-            const double error = get_error(buffer.data(), block_size, 0, 0, domain_avg,
-                                           range_plane,  range_stride, to_x, to_y, range_avg,
-                                           block_size, scale);
+    int best_domain = 0;
+    DomainPool::Fit best{};
+    best.error = 1e9;
+    auto try_domain = [&](int i) {
+        const DomainPool::Fit fit = pool.fit(i, sum_r, sum_rr, pool.dot(range, range_stride, i));
+        if (fit.error < best.error) {
+            best = fit;
+            best_domain = i;
+        }
+    };
+
+    if (search_ == DomainSearch::Nearest) {
+        // пустой ответ — плоский range-блок (или все домены плоские): любой домен подходит одинаково;
+        // пул пуст, если изображение не больше одного корневого блока, — тогда блок делится дальше
+        const std::vector<int> nearest = index[level].nearest(range, range_stride, nearest_);
+        for (const int i : nearest) {
+            try_domain(i);
+        }
+        if (nearest.empty() && pool.size() > 0) {
+            try_domain(0);
+        }
+    }
 
-            if (error < best_error) {
-                best_error   = error;
-                best_x       = x;
-                best_y       = y;
-                best_symmetry= symmetry_enum;
-                best_scale   = scale;
-                best_offset  = offset;
-            }
+    // классы домена с тем же порядком яркости квадрантов (s > 0) и с обратным (s < 0)
+    std::vector<int> classes;
+    if (search_ == DomainSearch::Class || search_ == DomainSearch::Neighbours) {
+        const int range_class = DomainPool::classify(range, range_stride, block_size);
+        classes = search_ == DomainSearch::Neighbours ? DomainPool::neighbour_classes(range_class) : std::vector<int>{range_class};
+        const size_t direct = classes.size();
+        for (size_t c = 0; c < direct; ++c) {
+            classes.push_back(DomainPool::inverse_class(classes[c]));
+        }
+    }
+    size_t candidates = 0;
+    for (const int c : classes) {
+        for (const int i : pool.members(c)) {
+            try_domain(i);
+        }
+        candidates += pool.members(c).size();
+    }
+    if (search_ != DomainSearch::Nearest && candidates == 0) {
+        for (int i = 0; i < pool.size(); ++i) {
+            try_domain(i);
         }
     }
 
-    if (block_size > 2 && best_error >= static_cast<double>(quality_)) {
+    if (block_size > 2 && best.error >= static_cast<double>(quality_)) {
         // Рекурсивное деление на 4 подблока
         const int half = block_size / 2;
-        find_matches_for(out, to_x,         to_y,         half, range_plane, range_stride, down_plane, down_stride, image_height);
-        find_matches_for(out, to_x + half,  to_y,         half, range_plane, range_stride, down_plane, down_stride, image_height);
-        find_matches_for(out, to_x,         to_y + half,  half, range_plane, range_stride, down_plane, down_stride, image_height);
-        find_matches_for(out, to_x + half,  to_y + half,  half, range_plane, range_stride, down_plane, down_stride, image_height);
+        find_matches_for(out, to_x,         to_y,         half, range_plane, range_stride, domains, index);
+        find_matches_for(out, to_x + half,  to_y,         half, range_plane, range_stride, domains, index);
+        find_matches_for(out, to_x,         to_y + half,  half, range_plane, range_stride, domains, index);
+        find_matches_for(out, to_x + half,  to_y + half,  half, range_plane, range_stride, domains, index);
     } else {
         // Лист квадродерева — сохраняем лучшую трансформацию
-        // NB: тип transform = std::vector<IFSTransform*>, поэтому пока raw-пойнтер.
-        out.push_back(std::make_unique<IFSTransform>(best_x, best_y,
+        out.push_back(std::make_unique<IFSTransform>(pool.x(best_domain), pool.y(best_domain),
                                              to_x, to_y,
                                              block_size,
-                                             best_symmetry,
-                                             best_scale,
-                                             best_offset));
+                                             IFSTransform::SYM_NONE,
+                                             best.scale,
+                                             best.offset));
     }
 }
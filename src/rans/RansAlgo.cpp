@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <dto/ByteHistogram.hpp>
+#include <dto/InputView.hpp>
+#include <rans/RansAlgo.hpp>
+
+void RansAlgo::SymbolStats::normalize(const uint64_t counts[256]) {
+    constexpr uint32_t kTotal = 1u << kScaleBits;
+    uint64_t total = 0;
+    for (unsigned s = 0; s < 256; ++s) total += counts[s];
+    std::fill(freq, freq + 256, 0);
+    if (total == 0) {
+        accumulate();
+        return;
+    }
+    uint32_t sum = 0;
+    unsigned largest = 0;
+    for (unsigned s = 0; s < 256; ++s) {
+        if (counts[s] == 0) continue;
+        freq[s] = std::max<uint32_t>(1, static_cast<uint32_t>(counts[s] * kTotal / total));
+        sum += freq[s];
+        if (counts[s] > counts[largest]) largest = s;
+    }
+    // rounding rare bytes up to 1 may overshoot: take the excess from the most frequent bytes
+    while (sum > kTotal) {
+        unsigned top = 0;
+        for (unsigned s = 1; s < 256; ++s) {
+            if (freq[s] > freq[top]) top = s;
+        }
+        const uint32_t take = std::min(sum - kTotal, freq[top] - 1);
+        freq[top] -= take;
+        sum -= take;
+    }
+    freq[largest] += kTotal - sum;
+    accumulate();
+}
+void RansAlgo::SymbolStats::accumulate() {
+    cum[0] = 0;
+    for (unsigned s = 0; s < 256; ++s) {
+        cum[s + 1] = cum[s] + freq[s];
+    }
+}
+void RansAlgo::send_common_information(const CommonInformation &common_information) {
+    send_message("RansAlgo{ ");
+    IController::send_common_information(common_information);
+    send_message("}\n");
+}
+void RansAlgo::send_error_information(const std::string &error) {
+    IController::send_error_information("RansAlgo{ " + error + "}\n");
+}
+std::vector<uint8_t> RansAlgo::encode_block(std::span<const uint8_t> data) {
+    uint64_t counts[256] = {};
+    ByteHistogram::count(data.data(), data.size(), counts);
+    SymbolStats stats;
+    stats.normalize(counts);
+
+    // presence mask, then every present frequency minus one in just enough bits for the largest of them
+    uint32_t largest = 0;
+    for (const uint32_t f: stats.freq) {
+        largest = std::max(largest, f);
+    }
+    const auto width = static_cast<unsigned>(std::bit_width(largest > 0 ? largest - 1 : 0u));
+    BitWriter table_stream(64 + 256 * kScaleBits / 8);
+    for (const uint32_t f: stats.freq) {
+        table_stream.put_bit(f != 0);
+    }
+    table_stream.put_bits(width, 4);
+    for (const uint32_t f: stats.freq) {
+        if (f != 0) table_stream.put_bits(f - 1, width);
+    }
+    const std::vector<uint8_t> table = table_stream.finish();
+
+    // a state at or above x_max[s] would overflow 32 bits after coding s: shift 16 bits out first
+    uint64_t x_max[256];
+    for (unsigned s = 0; s < 256; ++s) {
+        x_max[s] = (uint64_t{kStateLow >> kScaleBits} << 16) * stats.freq[s];
+    }
+
+    // rANS is last-in first-out: code the block backwards, filling the word buffer from its end
+    std::vector<uint16_t> words(data.size());
+    size_t top = words.size();
+    uint32_t state[kStates] = {kStateLow, kStateLow, kStateLow, kStateLow};
+    for (size_t i = data.size(); i-- > 0;) {
+        const uint8_t s = data[i];
+        const uint32_t f = stats.freq[s];
+        uint32_t x = state[i % kStates];
+        if (x >= x_max[s]) {
+            words[--top] = static_cast<uint16_t>(x);
+            x >>= 16;
+        }
+        state[i % kStates] = ((x / f) << kScaleBits) + (x % f) + stats.cum[s];
+    }
+
+    const size_t word_count = words.size() - top;
+    std::vector<uint8_t> payload(table.size() + sizeof(state) + word_count * sizeof(uint16_t));
+    uint8_t *p = payload.data();
+    std::memcpy(p, table.data(), table.size());
+    p += table.size();
+    std::memcpy(p, state, sizeof(state));
+    p += sizeof(state);
+    std::memcpy(p, words.data() + top, word_count * sizeof(uint16_t));
+    return payload;
+}
+void RansAlgo::decode_block(std::span<const uint8_t> payload, std::vector<uint8_t> &out) {
+    constexpr uint32_t kTotal = 1u << kScaleBits;
+    constexpr uint32_t kMask = kTotal - 1;
+
+    BitReader table_stream(payload.data(), payload.size());
+    SymbolStats stats;
+    bool present[256];
+    for (bool &p: present) {
+        p = table_stream.get_bit();
+    }
+    const auto width = static_cast<unsigned>(table_stream.get_bits(4));
+    if (width > kScaleBits) throw std::runtime_error("corrupt rANS block");
+    for (unsigned s = 0; s < 256; ++s) {
+        if (present[s]) stats.freq[s] = static_cast<uint32_t>(table_stream.get_bits(width)) + 1;
+    }
+    stats.accumulate();
+    const size_t table_bytes = (table_stream.bits_consumed() + 7) / 8;
+    uint32_t state[kStates];
+    if (stats.cum[256] != kTotal || payload.size() < table_bytes + sizeof(state)) {
+        throw std::runtime_error("corrupt rANS block");
+    }
+    std::memcpy(state, payload.data() + table_bytes, sizeof(state));
+    const uint8_t *words = payload.data() + table_bytes + sizeof(state);
+    const uint8_t *const words_end = payload.data() + payload.size();
+
+    // per slot: the symbol and the two terms of the state update x = freq * (x >> kScaleBits) + (slot - cum)
+    struct Slot {
+        uint16_t freq;
+        uint16_t bias;
+    };
+    std::vector<Slot> slots(kTotal);
+    std::vector<uint8_t> symbol(kTotal);
+    for (unsigned s = 0; s < 256; ++s) {
+        for (uint32_t slot = stats.cum[s]; slot < stats.cum[s + 1]; ++slot) {
+            slots[slot] = Slot{static_cast<uint16_t>(stats.freq[s]), static_cast<uint16_t>(slot - stats.cum[s])};
+            symbol[slot] = static_cast<uint8_t>(s);
+        }
+    }
+
+    bool overrun = false;
+    auto step = [&](uint32_t &x) -> uint8_t {
+        const uint32_t slot = x & kMask;
+        x = slots[slot].freq * (x >> kScaleBits) + slots[slot].bias;
+        if (x < kStateLow) {
+            uint16_t word = 0;
+            if (words < words_end) {
+                std::memcpy(&word, words, sizeof(uint16_t));
+                words += sizeof(uint16_t);
+            } else {
+                overrun = true;
+            }
+            x = (x << 16) | word;
+        }
+        return symbol[slot];
+    };
+    const size_t n = out.size();
+    size_t i = 0;
+    for (; i + kStates <= n; i += kStates) {
+        out[i] = step(state[0]);
+        out[i + 1] = step(state[1]);
+        out[i + 2] = step(state[2]);
+        out[i + 3] = step(state[3]);
+    }
+    for (; i < n; ++i) {
+        out[i] = step(state[i % kStates]);
+    }
+    // the encoder started every state at kStateLow and consumed exactly the payload
+    if (overrun || words != words_end ||
+        std::any_of(state, state + kStates, [](uint32_t x) { return x != kStateLow; })) {
+        throw std::runtime_error("corrupt rANS block");
+    }
+}
+void RansAlgo::encode(const std::string &input_filename) {
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t last_slash_pos = input_filename.find_last_of('/');
+    std::string tmp_input_filename =
+            last_slash_pos != std::string::npos ? input_filename.substr(last_slash_pos + 1) : input_filename;
+    std::string output_filename = "storageEncoded/" + tmp_input_filename + ".rans";// путь сохранения
+
+    const InputView input(input_filename);
+    if (!input.is_open()) {
+        send_error_information("Failed to open file: " + input_filename + '\n');
+        exit(-1);
+    }
+    std::ofstream output_file(output_filename, std::ios::binary);
+    if (!output_file.is_open()) {
+        send_error_information("Failed to write rANS file.\n");
+        exit(-1);
+    }
+    const std::span<const uint8_t> data = input.bytes();
+    const uint64_t count = data.size();
+    const uint32_t block_bytes = kBlockBytes;
+    output_file.write(reinterpret_cast<const char *>(kRansMagic.data()), kRansMagic.size());
+    output_file.write(reinterpret_cast<const char *>(&count), sizeof(uint64_t));
+    output_file.write(reinterpret_cast<const char *>(&block_bytes), sizeof(uint32_t));
+    for (uint64_t offset = 0; offset < count; offset += block_bytes) {
+        const std::vector<uint8_t> payload = encode_block(data.subspan(offset, std::min<uint64_t>(block_bytes, count - offset)));
+        const auto payload_size = static_cast<uint32_t>(payload.size());
+        output_file.write(reinterpret_cast<const char *>(&payload_size), sizeof(uint32_t));
+        output_file.write(reinterpret_cast<const char *>(payload.data()), payload_size);
+    }
+    output_file.close();
+    send_message("rANS data saved to: " + output_filename + '\n');
+
+    const auto size_output = static_cast<uint64_t>(get_filesize(output_filename));
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    double ratio = static_cast<double>(size_output) / static_cast<double>(count);
+    auto info = CommonInformation(ratio, static_cast<size_t>(duration.count()), count, size_output);
+    send_common_information(info);
+}
+void RansAlgo::decode(const std::string &input_filename) {
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t last_slash_pos = input_filename.find_last_of('/');
+    std::string tmp_input_filename =
+            last_slash_pos != std::string::npos ? input_filename.substr(last_slash_pos + 1) : input_filename;
+    size_t pos = tmp_input_filename.rfind(".rans");
+    std::string output_filename = "storageDecoded/" + tmp_input_filename.substr(0, pos);// путь сохранения
+
+    const InputView input(input_filename);
+    if (!input.is_open()) {
+        send_error_information("Failed to open file: " + input_filename + '\n');
+        exit(-1);
+    }
+    std::span<const uint8_t> data = input.bytes();
+    constexpr size_t kHeaderBytes = kRansMagic.size() + sizeof(uint64_t) + sizeof(uint32_t);
+    if (data.size() < kHeaderBytes || !std::equal(kRansMagic.begin(), kRansMagic.end(), data.begin())) {
+        throw std::runtime_error("not a rANS file");
+    }
+    uint64_t count = 0;
+    uint32_t block_bytes = 0;
+    std::memcpy(&count, data.data() + kRansMagic.size(), sizeof(uint64_t));
+    std::memcpy(&block_bytes, data.data() + kRansMagic.size() + sizeof(uint64_t), sizeof(uint32_t));
+    if (block_bytes == 0) throw std::runtime_error("corrupt rANS header");
+    data = data.subspan(kHeaderBytes);
+
+    std::ofstream out_file(output_filename, std::ios::binary);
+    std::vector<uint8_t> block;
+    for (uint64_t offset = 0; offset < count; offset += block_bytes) {
+        uint32_t payload_size = 0;
+        if (data.size() < sizeof(uint32_t)) throw std::runtime_error("truncated rANS file");
+        std::memcpy(&payload_size, data.data(), sizeof(uint32_t));
+        data = data.subspan(sizeof(uint32_t));
+        if (data.size() < payload_size) throw std::runtime_error("truncated rANS file");
+        block.resize(std::min<uint64_t>(block_bytes, count - offset));
+        decode_block(data.first(payload_size), block);
+        data = data.subspan(payload_size);
+        out_file.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(block.size()));
+    }
+    out_file.close();
+
+    const auto size_output = static_cast<uint64_t>(get_filesize(output_filename));
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    double ratio = static_cast<double>(size_output) / static_cast<double>(input.size());
+    auto info = CommonInformation(ratio, static_cast<size_t>(duration.count()), input.size(), size_output);
+    send_common_information(info);
+}
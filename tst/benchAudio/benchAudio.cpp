@@ -0,0 +1,45 @@
+// Single-core FLAC decode speed on ../testAudio/example0.wav, reported as a multiple of real time.
+// Build together with src/*.cpp except main.cpp and run from this directory.
+#include <audio/FlacAlgo.hpp>
+#include <dto/WAWHeader.hpp>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+static constexpr double kRequiredRealTime = 10.0;
+
+std::string read_file(const std::string &name) {
+    std::ifstream in(name, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+int main() {
+    const std::string source = "../testAudio/example0.wav";
+    std::filesystem::create_directory("storageEncoded");
+    std::filesystem::create_directory("storageDecoded");
+    std::ostringstream oss;
+    FlacAlgo algo{true, "", oss};
+
+    WavHeader header{};
+    std::ifstream(source, std::ios::binary).read(reinterpret_cast<char *>(&header), sizeof(WavHeader));
+    const double seconds = static_cast<double>(header.subchunk2_size) / header.byte_rate;
+
+    algo.encode(source, 1);
+    constexpr int kRepeats = 10;
+    double best = 1e100;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        algo.decode("storageEncoded/example0.flac", 1);
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    assert(read_file(source) == read_file("storageDecoded/example0.wav"));
+
+    const double real_time = seconds / best;
+    std::cout << "audio: " << seconds << " s, decode: " << best * 1000 << " ms, " << real_time << "x real time\n";
+    return real_time >= kRequiredRealTime ? 0 : 1;
+}
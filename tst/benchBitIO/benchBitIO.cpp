@@ -0,0 +1,150 @@
+// Throughput of BitStream (bit-at-a-time) against BitWriter/BitReader (64-bit accumulator)
+// on the Huffman and audio samples. Build together with src/dto/*.cpp and run from this directory.
+#include <dto/BitSteam.hpp>
+#include <dto/BitWriter.hpp>
+#include <dto/BitReader.hpp>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static constexpr int kRiceK = 8;
+
+std::vector<uint8_t> read_file(const std::string &name) {
+    std::ifstream in(name, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+double measure_mb_s(size_t bytes, const std::function<void()> &body) {
+    constexpr int kRepeats = 5;
+    double best = 1e100;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return static_cast<double>(bytes) / (1024.0 * 1024.0) / best;
+}
+
+void bench_bytes(const std::string &name) {
+    const std::vector<uint8_t> input = read_file(name);
+    if (input.empty()) {
+        std::cout << name << ": not found\n";
+        return;
+    }
+    std::vector<uint8_t> old_out;
+    std::vector<uint8_t> new_out;
+    double old_write = measure_mb_s(input.size(), [&] {
+        BitStream stream;
+        stream.add_bit(true); // keep the cursor unaligned, as after a Huffman code
+        for (uint8_t b: input) stream.add_byte(b);
+        old_out = std::move(stream.data);
+    });
+    double new_write = measure_mb_s(input.size(), [&] {
+        BitWriter writer(input.size() + 1);
+        writer.put_bit(true);
+        for (uint8_t b: input) writer.put_bits(b, 8);
+        new_out = writer.finish();
+    });
+    assert(old_out == new_out);
+    uint64_t old_sum = 0;
+    uint64_t new_sum = 0;
+    double old_read = measure_mb_s(input.size(), [&] {
+        BitStream stream(old_out);
+        old_sum = stream.get_bit();
+        for (size_t i = 0; i < input.size(); ++i) old_sum += stream.get_byte();
+    });
+    double new_read = measure_mb_s(input.size(), [&] {
+        BitReader reader(new_out);
+        new_sum = reader.get_bit();
+        for (size_t i = 0; i < input.size(); ++i) new_sum += reader.get_bits(8);
+    });
+    assert(old_sum == new_sum);
+    std::cout << name << " (8-bit symbols)\n"
+              << "  write: BitStream " << old_write << " MB/s, BitWriter " << new_write << " MB/s\n"
+              << "  read:  BitStream " << old_read << " MB/s, BitReader " << new_read << " MB/s\n";
+}
+
+void bench_rice(const std::string &name) {
+    std::vector<uint8_t> raw = read_file(name);
+    if (raw.size() <= 44) {
+        std::cout << name << ": not found\n";
+        return;
+    }
+    std::vector<int16_t> samples((raw.size() - 44) / 2);
+    std::memcpy(samples.data(), raw.data() + 44, samples.size() * 2);
+    const size_t bytes = samples.size() * 2;
+
+    std::vector<uint8_t> old_out;
+    std::vector<uint8_t> new_out;
+    double old_write = measure_mb_s(bytes, [&] {
+        BitStream stream;
+        for (int num: samples) {
+            stream.add_bit(num < 0);
+            num = num < 0 ? -num : num;
+            for (int i = 0; i < (num >> kRiceK); ++i) stream.add_bit(true);
+            stream.add_bit(false);
+            for (int i = 0; i < kRiceK; ++i) stream.add_bit((num >> (kRiceK - 1 - i)) & 1);
+        }
+        old_out = std::move(stream.data);
+    });
+    double new_write = measure_mb_s(bytes, [&] {
+        BitWriter writer(bytes);
+        for (int num: samples) {
+            writer.put_bit(num < 0);
+            num = num < 0 ? -num : num;
+            unsigned q = static_cast<unsigned>(num) >> kRiceK;
+            for (; q >= 32; q -= 32) writer.put_bits(0xFFFFFFFFu, 32);
+            writer.put_bits(((uint64_t{1} << q) - 1) << 1, q + 1);
+            writer.put_bits(static_cast<unsigned>(num), kRiceK);
+        }
+        new_out = writer.finish();
+    });
+    assert(old_out == new_out);
+    int64_t old_sum = 0;
+    int64_t new_sum = 0;
+    double old_read = measure_mb_s(bytes, [&] {
+        BitStream stream(old_out);
+        old_sum = 0;
+        for (size_t n = 0; n < samples.size(); ++n) {
+            int sgn = stream.get_bit() ? -1 : 1;
+            int q = 0;
+            while (stream.get_bit()) q++;
+            int num = q << kRiceK;
+            for (int j = 0; j < kRiceK; ++j)
+                if (stream.get_bit()) num |= 1 << (kRiceK - 1 - j);
+            old_sum += sgn * num;
+        }
+    });
+    double new_read = measure_mb_s(bytes, [&] {
+        BitReader reader(new_out);
+        new_sum = 0;
+        for (size_t n = 0; n < samples.size(); ++n) {
+            int sgn = reader.get_bit() ? -1 : 1;
+            int q = 0;
+            for (;;) {
+                int ones = std::countl_one(static_cast<uint32_t>(reader.peek_bits(32)));
+                reader.skip_bits(ones < 32 ? ones + 1 : 32);
+                q += ones;
+                if (ones < 32) break;
+            }
+            new_sum += sgn * ((q << kRiceK) | static_cast<int>(reader.get_bits(kRiceK)));
+        }
+    });
+    assert(old_sum == new_sum);
+    std::cout << name << " (Rice k=" << kRiceK << ", " << samples.size() << " samples)\n"
+              << "  write: BitStream " << old_write << " MB/s, BitWriter " << new_write << " MB/s\n"
+              << "  read:  BitStream " << old_read << " MB/s, BitReader " << new_read << " MB/s\n";
+}
+
+int main() {
+    bench_bytes("../testHaffman/example0.wav");
+    bench_bytes("../testHaffman/example1.bmp");
+    bench_rice("../testAudio/example0.wav");
+}
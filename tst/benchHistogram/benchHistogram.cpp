@@ -0,0 +1,76 @@
+// Throughput of the ByteHistogram kernels on uniform, skewed and single-byte inputs.
+// Build together with src/dto/ByteHistogram.cpp.
+#include <dto/ByteHistogram.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static constexpr size_t kInputBytes = 64 << 20;
+
+double measure_mb_s(size_t bytes, const std::function<void()> &body) {
+    constexpr int kRepeats = 5;
+    double best = 1e100;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return static_cast<double>(bytes) / (1024.0 * 1024.0) / best;
+}
+
+std::vector<uint8_t> make_uniform() {
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<uint8_t> data(kInputBytes);
+    for (auto &b: data) b = static_cast<uint8_t>(dist(gen));
+    return data;
+}
+
+std::vector<uint8_t> make_skewed() {
+    // geometric distribution: byte 0 about half the time, byte 1 a quarter, ...
+    std::mt19937 gen(2);
+    std::geometric_distribution<int> dist(0.5);
+    std::vector<uint8_t> data(kInputBytes);
+    for (auto &b: data) b = static_cast<uint8_t>(std::min(dist(gen), 255));
+    return data;
+}
+
+std::vector<uint8_t> make_single() {
+    return std::vector<uint8_t>(kInputBytes, 'a');
+}
+
+void bench(const std::string &name, const std::vector<uint8_t> &data) {
+    const std::pair<const char *, ByteHistogram::Kernel> kernels[] = {
+            {"scalar", ByteHistogram::Kernel::Scalar},
+            {"generic", ByteHistogram::Kernel::Generic},
+            {"avx2", ByteHistogram::Kernel::Avx2},
+    };
+    uint64_t reference[256] = {};
+    ByteHistogram::count(ByteHistogram::Kernel::Scalar, data.data(), data.size(), reference);
+    std::cout << name << ":";
+    for (const auto &[label, kernel]: kernels) {
+        uint64_t freq[256];
+        double speed = measure_mb_s(data.size(), [&] {
+            std::fill(freq, freq + 256, 0);
+            ByteHistogram::count(kernel, data.data(), data.size(), freq);
+        });
+        for (int c = 0; c < 256; ++c) assert(freq[c] == reference[c]);
+        std::cout << "  " << label << " " << std::lround(speed) << " MB/s";
+    }
+    std::cout << '\n';
+}
+
+int main() {
+    std::cout << "best kernel: " << (ByteHistogram::best_kernel() == ByteHistogram::Kernel::Avx2 ? "avx2" : "generic") << '\n';
+    bench("uniform", make_uniform());
+    bench("skewed", make_skewed());
+    bench("single-byte", make_single());
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Fractal encode speed, size and quality of ../testImage/Lena.bmp for each DomainSearch mode (and several k for
+// DomainSearch::Nearest): encode time, .fic size and PSNR of the decoded image against the source.
+// Then the same modes on random images no larger than one root block, whose top-level domain pool is empty.
+// Build together with src/*.cpp except main.cpp and run from this directory.
+#include <image/FractalAlgo.hpp>
+#include <image/Image.hpp>
+#include <image/stb_image_write.h>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+double psnr(const std::string &source, const std::string &decoded) {
+    std::ostringstream oss;
+    Image a{true, "", oss};
+    Image b{true, "", oss};
+    a.image_setup(source);
+    a.load();
+    b.image_setup(decoded);
+    b.load();
+    assert(a.width == b.width && a.height == b.height && a.channels == b.channels);
+    const pixel_value *planes_a[] = {a.image_data1, a.image_data2, a.image_data3};
+    const pixel_value *planes_b[] = {b.image_data1, b.image_data2, b.image_data3};
+    double squared = 0;
+    const size_t plane = static_cast<size_t>(a.width) * a.height;
+    for (int c = 0; c < a.channels; ++c) {
+        for (size_t i = 0; i < plane; ++i) {
+            const double d = planes_a[c][i] - planes_b[c][i];
+            squared += d * d;
+        }
+    }
+    const double mse = squared / static_cast<double>(plane * a.channels);
+    return 10 * std::log10(255.0 * 255.0 / mse);
+}
+
+// случайное RGB-изображение side x side: после паддинга это один корневой блок 32x32
+std::string write_small_image(int side) {
+    std::mt19937 gen(static_cast<unsigned>(side));
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<unsigned char> pixels(static_cast<size_t>(side) * side * 3);
+    for (auto &p: pixels) p = static_cast<unsigned char>(dist(gen));
+    const std::string name = "small" + std::to_string(side) + ".bmp";
+    const int ok = stbi_write_bmp(name.c_str(), side, side, 3, pixels.data());
+    assert(ok);
+    return name;
+}
+
+int main() {
+    const std::string source = "../testImage/Lena.bmp";
+    std::filesystem::create_directory("storageEncoded");
+    std::filesystem::create_directory("storageDecoded");
+    const std::tuple<DomainSearch, unsigned, const char *> modes[] = {
+            {DomainSearch::Full, 0, "full      "},
+            {DomainSearch::Neighbours, 0, "neighbours"},
+            {DomainSearch::Class, 0, "class     "},
+            {DomainSearch::Nearest, 64, "k = 64    "},
+            {DomainSearch::Nearest, 16, "k = 16    "},
+            {DomainSearch::Nearest, 4, "k = 4     "},
+    };
+    for (const int quality: {600, 200}) {
+        for (const auto &[search, k, name]: modes) {
+            std::ostringstream oss;
+            FractalAlgo algo{true, "", oss};
+            auto start = std::chrono::high_resolution_clock::now();
+            algo.encode(source, quality, 1, search, k);
+            auto end = std::chrono::high_resolution_clock::now();
+            algo.decode("storageEncoded/Lena.fic");
+            std::cout << "quality " << quality << ", " << name << ": "
+                      << std::chrono::duration<double, std::milli>(end - start).count() << " ms, "
+                      << std::filesystem::file_size("storageEncoded/Lena.fic") << " bytes, "
+                      << psnr(source, "storageDecoded/Lena.bmp") << " dB\n";
+        }
+    }
+    for (const int side: {8, 20, 32}) {
+        const std::string small = write_small_image(side);
+        const std::string stem = small.substr(0, small.rfind('.'));
+        for (const auto &[search, k, name]: modes) {
+            std::ostringstream oss;
+            FractalAlgo algo{true, "", oss};
+            algo.encode(small, 200, 1, search, k);
+            algo.decode("storageEncoded/" + stem + ".fic");
+            std::cout << side << "x" << side << ", " << name << ": "
+                      << std::filesystem::file_size("storageEncoded/" + stem + ".fic") << " bytes, "
+                      << psnr(small, "storageDecoded/" + small) << " dB\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Speed of the LPC autocorrelation kernels against the original per-lag loop of Lpc::train, on one FLAC-sized block.
+// Build together with src/audio/LpcAnalysis.cpp.
+#include <audio/LpcAnalysis.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static constexpr size_t kBlockSamples = 131072;
+static constexpr unsigned kMaxLag = 32;
+
+double measure_ms(const std::function<void()> &body) {
+    constexpr int kRepeats = 20;
+    double best = 1e100;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best * 1000;
+}
+
+std::vector<int32_t> make_block() {
+    // a few tones plus noise, roughly like music
+    std::mt19937 gen(1);
+    std::normal_distribution<double> noise(0, 300);
+    std::vector<int32_t> block(kBlockSamples);
+    for (size_t i = 0; i < block.size(); ++i) {
+        const double t = static_cast<double>(i);
+        block[i] = static_cast<int32_t>(8000 * std::sin(t * 0.013) + 3000 * std::sin(t * 0.071) + noise(gen));
+    }
+    return block;
+}
+
+/// The loop Lpc::train used before LpcAnalysis: integer products summed in double, one pass per lag.
+void autocorrelation_original(const std::vector<int32_t> &input, unsigned max_lag, double *r) {
+    const int n = static_cast<int>(input.size());
+    for (int i = 0; i <= static_cast<int>(max_lag); ++i) {
+        r[i] = 0;
+        for (int j = 0; j < n - i; ++j) {
+            r[i] += input[j] * input[j + i];
+        }
+    }
+}
+
+int main() {
+    const std::vector<int32_t> block = make_block();
+    const std::vector<float> windowed = LpcAnalysis::apply_window(block, LpcAnalysis::Window::Tukey);
+
+    for (const unsigned lags: {8u, kMaxLag}) {
+        double reference[kMaxLag + 1];
+        const double original = measure_ms([&] { autocorrelation_original(block, lags, reference); });
+        std::cout << "lags 0.." << lags << ": original " << original << " ms\n";
+
+        double expected[kMaxLag + 1];
+        LpcAnalysis::autocorrelation(LpcAnalysis::Kernel::Scalar, windowed, lags, expected);
+        const std::pair<const char *, LpcAnalysis::Kernel> kernels[] = {
+                {"scalar", LpcAnalysis::Kernel::Scalar},
+                {"generic", LpcAnalysis::Kernel::Generic},
+                {"avx2", LpcAnalysis::Kernel::Avx2},
+        };
+        for (const auto &[name, kernel]: kernels) {
+            double r[kMaxLag + 1];
+            const double ms = measure_ms([&] { LpcAnalysis::autocorrelation(kernel, windowed, lags, r); });
+            // every kernel adds the same exact products in the same order
+            assert(std::equal(r, r + lags + 1, expected));
+            std::cout << "  " << name << ": " << ms << " ms (" << original / ms << "x)\n";
+        }
+    }
+
+    // the whole analysis, window through all orders of the recursion
+    double coeffs[kMaxLag * kMaxLag];
+    double error[kMaxLag + 1];
+    const double analysis = measure_ms([&] {
+        const std::vector<float> x = LpcAnalysis::apply_window(block, LpcAnalysis::Window::Tukey);
+        double r[kMaxLag + 1];
+        LpcAnalysis::autocorrelation(x, kMaxLag, r);
+        LpcAnalysis::levinson_durbin(r, kMaxLag, coeffs, error);
+    });
+    std::cout << "window + autocorrelation + Levinson-Durbin (orders 1.." << kMaxLag << "): " << analysis << " ms\n";
+    return 0;
+}
@@ -0,0 +1,62 @@
+// Compressed size and decode speed of RansAlgo against HuffmanAlgo on the ../testHaffman samples.
+// Checks that both outputs decode back to the source.
+// Build together with src/*.cpp except main.cpp and run from this directory.
+#include <huffman/HuffmanAlgo.hpp>
+#include <rans/RansAlgo.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+std::string read_file(const std::string &name) {
+    std::ifstream in(name, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+double measure_ms(const std::function<void()> &body) {
+    constexpr int kRepeats = 5;
+    double best = 1e100;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+void bench(const std::string &name) {
+    const std::string source = "../testHaffman/" + name;
+    const std::string original = read_file(source);
+    std::ostringstream oss;
+    RansAlgo rans{true, "", oss};
+    HuffmanAlgo huffman{true, "", oss};
+
+    // оба декодера пишут в storageDecoded/<name>, поэтому результат проверяется сразу после каждого
+    rans.encode(source);
+    const double rans_ms = measure_ms([&] { rans.decode("storageEncoded/" + name + ".rans"); });
+    assert(read_file("storageDecoded/" + name) == original);
+    huffman.encode(source);
+    const double huffman_ms = measure_ms([&] { huffman.decode("storageEncoded/" + name + ".hcf"); });
+    assert(read_file("storageDecoded/" + name) == original);
+
+    const double mb = static_cast<double>(original.size()) / (1024.0 * 1024.0);
+    std::cout << name << " (" << original.size() << " bytes):\n"
+              << "  rans    " << std::filesystem::file_size("storageEncoded/" + name + ".rans") << " bytes, decode "
+              << rans_ms << " ms (" << mb * 1000 / rans_ms << " MB/s)\n"
+              << "  huffman " << std::filesystem::file_size("storageEncoded/" + name + ".hcf") << " bytes, decode "
+              << huffman_ms << " ms (" << mb * 1000 / huffman_ms << " MB/s)\n";
+}
+
+int main() {
+    std::filesystem::create_directory("storageEncoded");
+    std::filesystem::create_directory("storageDecoded");
+    bench("example0.wav");
+    bench("example1.bmp");
+    return 0;
+}
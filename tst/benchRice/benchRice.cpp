@@ -0,0 +1,114 @@
+// Speed of the block Rice coder against the per-value FlacAlgo::rice_encode/rice_decode it replaced, in samples per second.
+// Build together with src/audio/RiceCoder.cpp, src/dto/BitWriter.cpp and src/dto/BitReader.cpp.
+#include <audio/RiceCoder.hpp>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static constexpr size_t kSamples = 1 << 20;
+static constexpr unsigned kEscapeBits = 17;
+
+double measure_s(const std::function<void()> &body) {
+    constexpr int kRepeats = 10;
+    double best = 1e100;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best;
+}
+
+/// Residuals of a decent predictor: Laplacian with mean magnitude @p scale.
+std::vector<int32_t> make_residuals(double scale) {
+    std::mt19937 gen(1);
+    std::exponential_distribution<double> magnitude(1 / scale);
+    std::bernoulli_distribution negative(0.5);
+    std::vector<int32_t> residuals(kSamples);
+    for (int32_t &r: residuals) {
+        const auto m = static_cast<int32_t>(std::min(magnitude(gen), 65535.0));
+        r = negative(gen) ? -m : m;
+    }
+    return residuals;
+}
+
+/// FlacAlgo::rice_encode before the block coder: sign bit, ones for the quotient, zero, remainder.
+void rice_encode_original(BitWriter &stream, int num, unsigned k, unsigned escape_bits) {
+    stream.put_bit(num < 0);
+    num = std::abs(num);
+    const unsigned q = static_cast<unsigned>(num) >> k;
+    if (q >= RiceCoder::kEscapeRun) {
+        stream.put_bits((uint64_t{1} << RiceCoder::kEscapeRun) - 1, RiceCoder::kEscapeRun);
+        stream.put_bits(static_cast<unsigned>(num), escape_bits);
+        return;
+    }
+    stream.put_bits(((uint64_t{1} << q) - 1) << 1, q + 1);
+    stream.put_bits(static_cast<unsigned>(num), k);
+}
+
+/// FlacAlgo::rice_decode before the block coder.
+int rice_decode_original(BitReader &stream, unsigned k, unsigned escape_bits) {
+    const int sgn = stream.get_bit() ? -1 : 1;
+    const auto q = static_cast<unsigned>(std::countl_one(static_cast<uint32_t>(stream.peek_bits(32))));
+    if (q >= RiceCoder::kEscapeRun) {
+        stream.skip_bits(RiceCoder::kEscapeRun);
+        return sgn * static_cast<int>(stream.get_bits(escape_bits));
+    }
+    stream.skip_bits(q + 1);
+    return sgn * static_cast<int>((q << k) | stream.get_bits(k));
+}
+
+int main() {
+    for (const double scale: {4.0, 60.0, 2000.0}) {
+        const std::vector<int32_t> residuals = make_residuals(scale);
+        const std::vector<uint32_t> folded = RiceCoder::fold(residuals);
+        // the block coder folds the sign into the value, so its parameter is one higher for the same split
+        const unsigned k = RiceCoder::best_parameter(folded, kEscapeBits + 1);
+        const unsigned k_original = k > 0 ? k - 1 : 0;
+
+        std::vector<uint8_t> original;
+        const double encode_original = measure_s([&] {
+            BitWriter stream(kSamples);
+            for (const int32_t r: residuals) {
+                rice_encode_original(stream, r, k_original, kEscapeBits);
+            }
+            original = stream.finish();
+        });
+        std::vector<uint8_t> block;
+        const double encode_block = measure_s([&] {
+            BitWriter stream(kSamples);
+            RiceCoder::encode_block(stream, RiceCoder::fold(residuals), k, kEscapeBits + 1);
+            block = stream.finish();
+        });
+        assert(block.size() * 8 >= RiceCoder::cost(folded, k, kEscapeBits + 1));
+
+        std::vector<int32_t> decoded(kSamples);
+        const double decode_original = measure_s([&] {
+            BitReader stream(original);
+            for (int32_t &r: decoded) {
+                r = rice_decode_original(stream, k_original, kEscapeBits);
+            }
+        });
+        assert(decoded == residuals);
+        std::fill(decoded.begin(), decoded.end(), 0);
+        const double decode_block = measure_s([&] {
+            BitReader stream(block);
+            RiceCoder::decode_block(stream, decoded, k, kEscapeBits + 1);
+        });
+        assert(decoded == residuals);
+
+        const double msps = static_cast<double>(kSamples) / 1e6;
+        std::cout << "mean |residual| " << scale << ", k " << k << ": "
+                  << "encode " << msps / encode_original << " -> " << msps / encode_block << " Msamples/s, "
+                  << "decode " << msps / decode_original << " -> " << msps / decode_block << " Msamples/s, "
+                  << "size " << original.size() << " -> " << block.size() << " bytes\n";
+    }
+    return 0;
+}
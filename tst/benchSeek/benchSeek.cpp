@@ -0,0 +1,65 @@
+// Random access into a .flac file: FlacAlgo::decode_range against the source samples, and its speed against a full decode.
+// Build together with src/*.cpp except main.cpp and run from this directory.
+#include <audio/FlacAlgo.hpp>
+#include <audio/WavReader.hpp>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+double measure_ms(const std::function<void()> &body) {
+    constexpr int kRepeats = 10;
+    double best = 1e100;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best * 1000;
+}
+
+int main() {
+    const std::string source = "../testAudio/example0.wav";
+    const std::string encoded = "storageEncoded/example0.flac";
+    std::filesystem::create_directory("storageEncoded");
+    std::filesystem::create_directory("storageDecoded");
+    std::ostringstream oss;
+    FlacAlgo algo{true, "", oss};
+    algo.encode(source, 1);
+
+    const WavReader reader(source);
+    assert(reader.is_open());
+    const uint64_t frames = reader.frames();
+    const unsigned channels = reader.channels();
+
+    // start, inside a block, across a block boundary, the tail (clamped) and an empty range at the end
+    const std::pair<uint64_t, uint64_t> ranges[] = {
+            {0, 1000},
+            {12345, 777},
+            {kGlobalSizeBlocks - 100, 200},
+            {frames - 10, 1000},
+            {frames, 5},
+    };
+    for (const auto &[first, count]: ranges) {
+        if (first > frames) continue;
+        const std::vector<int32_t> samples = algo.decode_range(encoded, first, count);
+        const uint64_t expected = std::min(count, frames - first);
+        assert(samples.size() == expected * channels);
+        for (uint64_t i = 0; i < expected; ++i) {
+            for (unsigned c = 0; c < channels; ++c) {
+                assert(samples[i * channels + c] == reader.sample(first + i, c));
+            }
+        }
+    }
+
+    const double full = measure_ms([&] { algo.decode(encoded, 1); });
+    const double range = measure_ms([&] { algo.decode_range(encoded, frames / 2, 4410); });
+    std::cout << "frames: " << frames << ", full decode: " << full << " ms, 0.1 s at the middle: " << range << " ms ("
+              << full / range << "x)\n";
+    return 0;
+}
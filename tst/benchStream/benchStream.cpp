@@ -0,0 +1,65 @@
+// How many live streams one core can encode: FlacAlgo::StreamEncoder instances fed round-robin from one thread with
+// ../testAudio/example0.wav (44.1 kHz), in chunks of 10 ms as a capture device would deliver them. Checks that the output decodes.
+// Build together with src/*.cpp except main.cpp and run from this directory.
+#include <audio/FlacAlgo.hpp>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static constexpr size_t kStreams = 16;
+
+std::string read_file(const std::string &name) {
+    std::ifstream in(name, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+int main() {
+    const std::string source = "../testAudio/example0.wav";
+    std::filesystem::create_directory("storageEncoded");
+    std::filesystem::create_directory("storageDecoded");
+    const std::string wav = read_file(source);
+    const std::span<const uint8_t> bytes(reinterpret_cast<const uint8_t *>(wav.data()), wav.size());
+    const WavReader reader(source);
+    const double seconds = static_cast<double>(reader.frames()) / 44100;
+    const size_t chunk = 441 * reader.channels() * (reader.bits_per_sample() / 8u);
+
+    for (const bool fast: {false, true}) {
+        for (const uint32_t block_frames: {1024u, kStreamBlockFrames, 16384u}) {
+            std::vector<std::unique_ptr<std::ofstream>> outputs;
+            std::vector<std::unique_ptr<FlacAlgo::StreamEncoder>> encoders;
+            for (size_t i = 0; i < kStreams; ++i) {
+                outputs.push_back(std::make_unique<std::ofstream>("storageEncoded/stream" + std::to_string(i) + ".flac", std::ios::binary));
+                encoders.push_back(std::make_unique<FlacAlgo::StreamEncoder>(*outputs.back(), block_frames, fast));
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t offset = 0; offset < bytes.size(); offset += chunk) {
+                for (auto &encoder: encoders) {
+                    encoder->push(bytes.subspan(offset, std::min(chunk, bytes.size() - offset)));
+                }
+            }
+            for (auto &encoder: encoders) {
+                encoder->finish();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            outputs.clear();
+
+            std::ostringstream oss;
+            FlacAlgo algo{true, "", oss};
+            algo.decode("storageEncoded/stream0.flac", 1);
+            assert(read_file("storageDecoded/stream0.wav") == wav);
+
+            const double elapsed = std::chrono::duration<double>(end - start).count();
+            const double real_time = seconds * kStreams / elapsed;
+            std::cout << (fast ? "fast" : "lpc ") << ", block " << block_frames << " frames (" << block_frames * 1000.0 / 44100
+                      << " ms): " << std::filesystem::file_size("storageEncoded/stream0.flac") << " bytes, "
+                      << real_time << "x real time per core, i.e. " << static_cast<size_t>(real_time) << " live streams\n";
+        }
+    }
+    return 0;
+}
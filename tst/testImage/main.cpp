@@ -15,10 +15,10 @@ int main() {
     std::string sourceImage3 = "sample.tga";
     currentPath = fs::current_path();
     fractalAlgo.encode(sourceImage1, 500);
-    fractalAlgo.decode(sourceImage1, 5);
+    fractalAlgo.decode("storageEncoded/Lena.fic", 5);
     fractalAlgo.encode(sourceImage2, 900);
-    fractalAlgo.decode(sourceImage2, 5);
+    fractalAlgo.decode("storageEncoded/Pingvin.fic", 5);
     fractalAlgo.encode(sourceImage3, 800);
-    fractalAlgo.decode(sourceImage3, 5);
+    fractalAlgo.decode("storageEncoded/sample.fic", 5);
     return 0;
 }
\ No newline at end of file
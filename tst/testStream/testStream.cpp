@@ -0,0 +1,46 @@
+// "enc -o stream -f -": the Selector routes the stream option to FLAC whatever the file name, and ../testAudio/example0.wav
+// piped through standard input encodes to the same bytes as the file itself (with the block size of encode()).
+// Build together with src/*.cpp except main.cpp and run from this directory.
+#include <audio/FlacAlgo.hpp>
+#include <controller/Selector.hpp>
+#include <dto/Dto.hpp>
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+std::string read_file(const std::string &name) {
+    std::ifstream in(name, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+int main() {
+    const std::string source = "../testAudio/example0.wav";
+    std::filesystem::create_directory("storageEncoded");
+    std::filesystem::create_directory("storageDecoded");
+
+    assert(Selector::get_algorithm_from_dto(Dto(true, {"stream"}, {"-"})) == AlgorithmEnum::FLAC);
+    assert(Selector::get_algorithm_from_dto(Dto(true, {"fast", "stream"}, {"/dev/stdin"})) == AlgorithmEnum::FLAC);
+    assert(Selector::get_algorithm_from_dto(Dto(true, {}, {"-"})) != AlgorithmEnum::FLAC);
+
+    std::ostringstream oss;
+    FlacAlgo algo{true, "", oss};
+    algo.encode(source, 1);
+    const std::string from_file = read_file("storageEncoded/example0.flac");
+
+    // как в "cat example0.wav | archivator enc -o stream -f -"
+    if (!std::freopen(source.c_str(), "rb", stdin)) {
+        std::cerr << "cannot open " << source << '\n';
+        return 1;
+    }
+    algo.encode_stream("-", kGlobalSizeBlocks);
+    assert(read_file("storageEncoded/stdin.flac") == from_file);
+
+    algo.decode("storageEncoded/stdin.flac", 1);
+    assert(read_file("storageDecoded/stdin.wav") == read_file(source));
+    std::cout << "stdin stream matches the file encode" << std::endl;
+    return 0;
+}